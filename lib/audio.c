@@ -0,0 +1,68 @@
+# include <stdlib.h>
+# include <string.h>
+# include "audio.h"
+# include "raylib.h"
+
+
+SoundCache *createSoundCache() {
+    SoundCache *cache = (SoundCache *)malloc(sizeof(SoundCache));
+    cache->count = 0;
+
+    return cache;
+}
+
+CachedSound *findCachedSound(SoundCache *cache, const char *path) {
+    for (int i = 0; i < cache->count; ++i) {
+        if (strcmp(cache->entries[i].path, path) == 0) return &cache->entries[i];
+    }
+
+    if (cache->count == SOUND_CACHE_CAPACITY || strlen(path) >= SOUND_PATH_SIZE) {
+        TraceLog(LOG_WARNING, "AUDIO: Could not cache %s", path);
+        return NULL;
+    }
+
+    CachedSound *entry = &cache->entries[cache->count++];
+    Wave wave = LoadWave(path);
+    strcpy(entry->path, path);
+    entry->sound = LoadSoundFromWave(wave);
+    UnloadWave(wave);
+
+    return entry;
+}
+
+SoundEffect loadSoundEffect(SoundCache *cache, const char *path, int voices) {
+    SoundEffect effect = {.voiceCount=0, .next=0};
+    CachedSound *entry = findCachedSound(cache, path);
+    if (entry == NULL) return effect;
+
+    if (voices > MAX_VOICES) voices = MAX_VOICES;
+    for (int i = 0; i < voices; ++i) {
+        effect.voices[i] = LoadSoundAlias(entry->sound);
+    }
+    effect.voiceCount = voices;
+
+    return effect;
+}
+
+void playSoundEffect(SoundEffect *effect) {
+    if (effect->voiceCount == 0) return;
+
+    // Voices are handed out round-robin, so the next one is always the one
+    // that started longest ago and stealing it costs nothing to find
+    PlaySound(effect->voices[effect->next]);
+    effect->next = (effect->next + 1) % effect->voiceCount;
+}
+
+void unloadSoundEffect(SoundEffect *effect) {
+    for (int i = 0; i < effect->voiceCount; ++i) {
+        UnloadSoundAlias(effect->voices[i]);
+    }
+    effect->voiceCount = 0;
+}
+
+void freeSoundCache(SoundCache *cache) {
+    for (int i = 0; i < cache->count; ++i) {
+        UnloadSound(cache->entries[i].sound);
+    }
+    free(cache);
+}
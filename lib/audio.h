@@ -0,0 +1,40 @@
+# ifndef _AUDIO_H_
+# define _AUDIO_H_
+
+# include "raylib.h"
+
+# define SOUND_CACHE_CAPACITY 16
+# define SOUND_PATH_SIZE 128
+# define MAX_VOICES 8
+
+typedef struct CachedSound {
+    char path[SOUND_PATH_SIZE];
+    Sound sound;
+} CachedSound;
+
+// Decoded PCM outlives the game it was loaded for, restarting does not
+// decode the same files again
+typedef struct SoundCache {
+    CachedSound entries[SOUND_CACHE_CAPACITY];
+    int count;
+} SoundCache;
+
+// Every voice aliases the cached buffer, so an effect can overlap itself up
+// to voiceCount times; past that the oldest voice is restarted
+typedef struct SoundEffect {
+    Sound voices[MAX_VOICES];
+    int voiceCount;
+    int next;
+} SoundEffect;
+
+SoundCache *createSoundCache();
+
+SoundEffect loadSoundEffect(SoundCache *, const char *path, int voices);
+
+void playSoundEffect(SoundEffect *);
+
+void unloadSoundEffect(SoundEffect *);
+
+void freeSoundCache(SoundCache *);
+
+# endif
@@ -0,0 +1,185 @@
+# include <stdlib.h>
+# include <string.h>
+# include "bunker.h"
+# include "hash.h"
+# include "raylib.h"
+
+
+// Eight columns wide, centered between bits 3 and 4
+static const uint64_t crater[BUNKER_CRATER_ROWS] = {0x18, 0x3C, 0x7E, 0xFF, 0x7E, 0x24};
+
+void buildBunkerShape(uint64_t shape[]) {
+    const float archCenter = (BUNKER_COLUMNS - 1)/2.0f;
+    const float archWidth = 14.0f;
+    const float archHeight = 12.0f;
+    const int corner = 8;
+
+    for (int r = 0; r < BUNKER_ROWS; ++r) {
+        uint64_t row = 0;
+        for (int c = 0; c < BUNKER_COLUMNS; ++c) {
+            bool cornerCut = c + r < corner || (BUNKER_COLUMNS - 1 - c) + r < corner;
+            float dx = (c - archCenter)/archWidth;
+            float dy = (r - BUNKER_ROWS)/archHeight;
+            bool archCut = dx*dx + dy*dy < 1.0f;
+            if (!cornerCut && !archCut) row |= 1ull << c;
+        }
+        shape[r] = row;
+    }
+}
+
+Bunkers *createBunkers(int count, float y, float left, float right, RenderBackend *renderer) {
+    const float width = BUNKER_COLUMNS*BUNKER_CELL;
+    const float height = BUNKER_ROWS*BUNKER_CELL;
+    const float spacing = (right - left)/count;
+
+    Bunkers *bunkers = (Bunkers *)malloc(sizeof(Bunkers));
+    bunkers->cells = malloc(count*sizeof(*bunkers->cells));
+    bunkers->bounds = (Rectangle *)malloc(count*sizeof(Rectangle));
+    bunkers->textures = (Texture2D *)malloc(count*sizeof(Texture2D));
+    bunkers->dirty = (uint8_t *)malloc(count*sizeof(uint8_t));
+    bunkers->pixels = (Color *)malloc(BUNKER_COLUMNS*BUNKER_ROWS*sizeof(Color));
+    bunkers->count = count;
+    buildBunkerShape(bunkers->shape);
+
+    for (int i = 0; i < count; ++i) {
+        float x = left + spacing*(i + 0.5f) - width/2.0f;
+        bunkers->bounds[i] = (Rectangle){.height=height, .width=width, .x=x, .y=y};
+        bunkers->textures[i] = renderer->createTexture(renderer, BUNKER_COLUMNS, BUNKER_ROWS);
+    }
+    resetBunkers(bunkers);
+
+    return bunkers;
+}
+
+uint64_t hashBunkerRow(int bunker, int row, uint64_t cells) {
+    return mixHash(cells ^ mixHash((uint64_t)bunker*BUNKER_ROWS + row + 1));
+}
+
+void rehashBunkers(Bunkers *bunkers) {
+    bunkers->hash = 0;
+    for (int i = 0; i < bunkers->count; ++i) {
+        for (int r = 0; r < BUNKER_ROWS; ++r) {
+            bunkers->hash ^= hashBunkerRow(i, r, bunkers->cells[i][r]);
+        }
+    }
+}
+
+void resetBunkers(Bunkers *bunkers) {
+    for (int i = 0; i < bunkers->count; ++i) {
+        memcpy(bunkers->cells[i], bunkers->shape, sizeof(bunkers->shape));
+        bunkers->dirty[i] = 1;
+    }
+    rehashBunkers(bunkers);
+}
+
+// Bits first..last inclusive
+uint64_t columnMask(int first, int last) {
+    uint64_t upper = last >= BUNKER_COLUMNS - 1 ? ~0ull : (1ull << (last + 1)) - 1;
+    return upper & ~((1ull << first) - 1);
+}
+
+void carveCrater(Bunkers *bunkers, int bunker, int row, int column) {
+    uint64_t *cells = bunkers->cells[bunker];
+    int shift = column - 4;
+    int top = row - BUNKER_CRATER_ROWS/2;
+
+    for (int k = 0; k < BUNKER_CRATER_ROWS; ++k) {
+        int r = top + k;
+        if (r < 0 || r >= BUNKER_ROWS) continue;
+        uint64_t stamp = shift >= 0 ? crater[k] << shift : crater[k] >> -shift;
+        bunkers->hash ^= hashBunkerRow(bunker, r, cells[r]);
+        cells[r] &= ~stamp;
+        bunkers->hash ^= hashBunkerRow(bunker, r, cells[r]);
+    }
+}
+
+// Checks rows in the order the projectile meets them, the first row with a
+// solid cell under its columns takes the crater and stops it
+bool hitBunker(Bunkers *bunkers, int bunker, Rectangle local, bool up) {
+    const uint64_t *cells = bunkers->cells[bunker];
+    int firstColumn = (int)(local.x/BUNKER_CELL);
+    int lastColumn = (int)((local.x + local.width)/BUNKER_CELL);
+    int firstRow = (int)(local.y/BUNKER_CELL);
+    int lastRow = (int)((local.y + local.height)/BUNKER_CELL);
+
+    if (firstColumn < 0) firstColumn = 0;
+    if (lastColumn > BUNKER_COLUMNS - 1) lastColumn = BUNKER_COLUMNS - 1;
+    if (firstRow < 0) firstRow = 0;
+    if (lastRow > BUNKER_ROWS - 1) lastRow = BUNKER_ROWS - 1;
+    if (firstColumn > lastColumn || firstRow > lastRow) return false;
+
+    uint64_t mask = columnMask(firstColumn, lastColumn);
+    int step = up ? -1 : 1;
+    int start = up ? lastRow : firstRow;
+    int end = up ? firstRow - 1 : lastRow + 1;
+
+    for (int r = start; r != end; r += step) {
+        uint64_t solid = cells[r] & mask;
+        if (solid) {
+            // Centre the crater on the solid cell closest to the middle of
+            // the projectile
+            int middle = (firstColumn + lastColumn)/2;
+            uint64_t right = solid >> middle;
+            int column = right ? middle + __builtin_ctzll(right) : 63 - __builtin_clzll(solid);
+            carveCrater(bunkers, bunker, r, column);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool hitBunkers(Bunkers *bunkers, Rectangle bounds, bool up) {
+    for (int i = 0; i < bunkers->count; ++i) {
+        Rectangle area = bunkers->bounds[i];
+        if (bounds.x > area.x + area.width || bounds.x + bounds.width < area.x ||
+            bounds.y > area.y + area.height || bounds.y + bounds.height < area.y) continue;
+
+        Rectangle local = bounds;
+        local.x -= area.x;
+        local.y -= area.y;
+        if (hitBunker(bunkers, i, local, up)) {
+            bunkers->dirty[i] = 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void uploadBunker(Bunkers *bunkers, int index, RenderBackend *renderer) {
+    const Color solid = GREEN;
+    const Color empty = BLANK;
+    Color *pixels = bunkers->pixels;
+
+    for (int r = 0; r < BUNKER_ROWS; ++r) {
+        uint64_t row = bunkers->cells[index][r];
+        for (int c = 0; c < BUNKER_COLUMNS; ++c) {
+            pixels[r*BUNKER_COLUMNS + c] = (row >> c) & 1 ? solid : empty;
+        }
+    }
+    renderer->updateTexture(renderer, bunkers->textures[index], pixels);
+    bunkers->dirty[index] = 0;
+}
+
+void drawBunkers(Bunkers *bunkers, RenderBackend *renderer) {
+    const Rectangle source = {.height=BUNKER_ROWS, .width=BUNKER_COLUMNS, .x=0.0f, .y=0.0f};
+
+    for (int i = 0; i < bunkers->count; ++i) {
+        // Only bunkers that took a hit since the last frame go to the GPU
+        if (bunkers->dirty[i]) uploadBunker(bunkers, i, renderer);
+        renderer->texture(renderer, bunkers->textures[i], source, bunkers->bounds[i], WHITE);
+    }
+}
+
+void freeBunkers(Bunkers *bunkers, RenderBackend *renderer) {
+    for (int i = 0; i < bunkers->count; ++i) {
+        renderer->unloadTexture(renderer, bunkers->textures[i]);
+    }
+    free(bunkers->cells);
+    free(bunkers->bounds);
+    free(bunkers->textures);
+    free(bunkers->dirty);
+    free(bunkers->pixels);
+    free(bunkers);
+}
@@ -0,0 +1,43 @@
+# ifndef _BUNKER_H_
+# define _BUNKER_H_
+
+# include <stdlib.h>
+# include <stdint.h>
+# include <stdbool.h>
+# include "render.h"
+# include "raylib.h"
+
+# define BUNKER_COUNT 4
+# define BUNKER_COLUMNS 64
+# define BUNKER_ROWS 32
+# define BUNKER_CELL 2.0f
+# define BUNKER_CRATER_ROWS 6
+
+// Each bunker is a bitboard, one 64 bit word per row and bit c is column c.
+// Hits and craters are masks over whole rows, nothing walks single cells
+// except the upload of a bunker that changed.
+typedef struct Bunkers {
+    uint64_t (*cells)[BUNKER_ROWS];
+    uint64_t shape[BUNKER_ROWS];
+    Rectangle *bounds;
+    Texture2D *textures;
+    uint8_t *dirty;
+    Color *pixels;
+    // XOR of every row's hash, patched row by row as craters land
+    uint64_t hash;
+    int count;
+} Bunkers;
+
+Bunkers *createBunkers(int count, float y, float left, float right, RenderBackend *);
+
+void resetBunkers(Bunkers *);
+
+void rehashBunkers(Bunkers *);
+
+bool hitBunkers(Bunkers *, Rectangle bounds, bool up);
+
+void drawBunkers(Bunkers *, RenderBackend *);
+
+void freeBunkers(Bunkers *, RenderBackend *);
+
+# endif
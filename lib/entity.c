@@ -1,168 +1,246 @@
 # include <stdlib.h>
 # include <stdio.h>
+# include <math.h>
 # include "entity.h"
 # include "raylib.h"
 
 
 Entity *createPlayerShip() {
+    Entity *ship = (Entity *)malloc(sizeof(Entity));
+    ship->type = PLAYER_SHIP;
+    resetPlayerShip(ship);
+    return ship;
+}
+
+void resetPlayerShip(Entity *ship) {
     const float height = 72.0f;
     const float width = 96.0f;
     const float x = 912.0f;
     const float y = 900.0f;
 
-    Entity *ship = (Entity *)malloc(sizeof(Entity));
-    ship->type = PLAYER_SHIP;
     ship->bounds = (Rectangle){.height=height, .width=width, .x=x, .y=y};
-    return ship;
 }
 
 Entity *createEnemyShip() {
+    Entity *enemyShip = (Entity *)malloc(sizeof(Entity));
+    enemyShip->type = ENEMY_SHIP;
+    resetEnemyShip(enemyShip);
+    return enemyShip;
+}
+
+void resetEnemyShip(Entity *enemyShip) {
     const float height = 40.0f;
     const float width = 64.0f;
     const float x = 1920.0f;
     const float y = 50.0f;
 
-    Entity *enemyShip = (Entity *)malloc(sizeof(Entity));
-    enemyShip->type = ENEMY_SHIP;
     enemyShip->bounds = (Rectangle){.height=height, .width=width, .x=x, .y=y};
-    return enemyShip;
 }
 
-Entity *createListEntities() {
-    Entity *leftSentinel = (Entity *)malloc(sizeof(Entity));
-    Entity *rightSentinel = (Entity *)malloc(sizeof(Entity));
-    leftSentinel->next = rightSentinel;
-    rightSentinel->prev = leftSentinel;
-    leftSentinel->type = LIST_SENTINEL;
-    rightSentinel->type = LIST_SENTINEL;
+Entity *createHorde() {
+    const int sizeHorde = HORDE_SIZE;
+
+    // The aliens sit in one block between the two sentinels, so update passes
+    // can split the formation by index; the links only track who is alive.
+    // Every wave reuses this block, resetHorde() lays it out in place.
+    Entity *pool = (Entity *)malloc((sizeHorde + 2)*sizeof(Entity));
+    pool[0].type = LIST_SENTINEL;
+    pool[sizeHorde + 1].type = LIST_SENTINEL;
+    for (int i = 1; i <= sizeHorde; ++i) {
+        pool[i].type = ALIEN;
+        pool[i].alive = false;
+    }
+    relinkHorde(pool);
 
-    return leftSentinel;
+    return pool;
 }
 
-Entity *createHorde() {
-    const int sizeHorde = 55;
-    const int rows = 5;
-    const int columns = 11;
+Entity *resetHorde(Entity *horde, const LevelWave *wave, int kindStart[]) {
+    const int sizeHorde = HORDE_SIZE;
+    const int columns = wave->columns;
+    const int used = wave->rows*wave->columns;
     const float height = 32.0f;
     const float width = 32.0f;
     const float gapX = 15.0f;
     const float gapY = 20.0f;
     const float offSetX = 1920.0f/2.0f - (width*(float)columns + gapX*((float)columns - 1.0f))/2.0f;
     const float offSetY = height*3.0f;
-    float x, y;
-
-    Entity *leftSentinel = createListEntities();
 
-    Entity *current = leftSentinel;
+    // Slots past the formation stay dead but keep a grid position, so they
+    // move along with it like any other dead alien
+    int band = 0;
+    int bandEnd = wave->bands[0].rows;
     for (int i = 0; i < sizeHorde; ++i) {
+        int row = i / columns;
         float x = offSetX + ((i % columns)*(width + gapX));
-        float y = offSetY + ((i / columns)*(height + gapY));
+        float y = offSetY + (row*(height + gapY));
 
-        Entity *temp = (Entity *)malloc(sizeof(Entity));
-        temp->bounds = (Rectangle){.height=height, .width=width, .x=x, .y=y};
-        if (i / columns < 2) temp->alienType = TYPE1;
-        else if (i / columns < 3) temp->alienType = TYPE2;
-        else temp->alienType = TYPE3;
+        while (band < wave->bandCount - 1 && row >= bandEnd) bandEnd += wave->bands[++band].rows;
 
-        temp->type = ALIEN;
+        Entity *alien = &horde[i + 1];
+        alien->bounds = (Rectangle){.height=height, .width=width, .x=x, .y=y};
+        alien->alienType = (AlienTexture)wave->bands[band].kind;
+        alien->alive = i < used;
+    }
+    Entity *last = relinkHorde(horde);
 
-        temp->next = current->next;
-        current->next->prev = temp;
-        current->next = temp;
-        temp->prev = current;
-        current = temp;
+    // Kinds come in bands of rows, so each one is a contiguous index range
+    for (int kind = 0, i = 0; kind <= ALIEN_KIND_COUNT; ++kind) {
+        while (i < used && (int)horde[i + 1].alienType < kind) ++i;
+        kindStart[kind] = i;
     }
 
-    return leftSentinel;
+    return last;
 }
 
-Entity *findLastAlive(Entity *horde) {
-    Entity *current;
-    for (current = horde->next; current->next->type != LIST_SENTINEL; current = current->next);
-    return current;
+// Rebuilds the links from the alive flags, returns the last alien standing or
+// the left sentinel when there is none
+Entity *relinkHorde(Entity *horde) {
+    Entity *last = horde;
+    for (int i = 1; i <= HORDE_SIZE; ++i) {
+        if (!horde[i].alive) continue;
+        last->next = &horde[i];
+        horde[i].prev = last;
+        last = &horde[i];
+    }
+    last->next = &horde[HORDE_SIZE + 1];
+    horde[HORDE_SIZE + 1].prev = last;
+
+    return last;
 }
 
 void killEnemy(Entity *enemy) {
     enemy->next->prev = enemy->prev;
     enemy->prev->next = enemy->next;
-    free(enemy);
-}
-
-void generateProjectile(
-    Entity *list, float height, float width, float x, float y, bool up
-) {
-    Entity *projectile = (Entity *)malloc(sizeof(Entity));
-    projectile->bounds = (Rectangle){.height=height, .width=width, .x=x, .y=y};
-    projectile->up = up;
-
-    projectile->next = list->next;
-    projectile->prev = list;
-    projectile->next->prev = projectile;
-    projectile->prev->next = projectile;
-}
-
-void killProjectile(Entity *projectile) {
-    projectile->next->prev = projectile->prev;
-    projectile->prev->next = projectile->next;
-    free(projectile);
-}
-
-Entity *createBulletsList() {
-    return createListEntities();
-}
-
-void generateBullet(Entity *list, float x, float y, bool up) {
-    const float height = 32.0f;
-    const float width = 4.0f;
-
-    generateProjectile(list, height, width, x - width/2.0f, y, up);
-    list->next->type = BULLET;
-}
-
-void killBullet(Entity *bullet) {
-    killProjectile(bullet);
-}
-
-Entity *createPowerupsList() {
-    return createListEntities();
-}
-
-void generatePowerup(Entity *list, float x, float y) {
-    const float width = 25.0f;
-    int dropCheck = rand() % 100;
-
-    generateProjectile(list, width, width, x - width/2.0f, y, false);
-    if (dropCheck < 50) list->next->type = FAST_MOVE;
-    else list->next->type = FAST_SHOT;
+    enemy->alive = false;
+}
+
+Projectiles *createProjectiles(float width, float height, float velocity) {
+    const int capacity = PROJECTILES_CAPACITY;
+
+    Projectiles *projectiles = (Projectiles *)malloc(sizeof(Projectiles));
+    projectiles->x = (Coord *)malloc(capacity*sizeof(Coord));
+    projectiles->y = (Coord *)malloc(capacity*sizeof(Coord));
+    projectiles->alive = (uint8_t *)malloc(capacity*sizeof(uint8_t));
+    projectiles->order = (int *)malloc(capacity*sizeof(int));
+    projectiles->remap = (int *)malloc(capacity*sizeof(int));
+    projectiles->ordered = 0;
+    projectiles->count = 0;
+    projectiles->capacity = capacity;
+    projectiles->width = width;
+    projectiles->height = height;
+    projectiles->velocity = velocity;
+    projectiles->travel = 0.0f;
+
+    return projectiles;
+}
+
+int generateProjectile(Projectiles *projectiles, float x, float y) {
+    // A full pool drops the shot rather than growing mid-frame
+    if (projectiles->count == projectiles->capacity) return -1;
+
+    int index = projectiles->count++;
+    projectiles->x[index] = toCoord(x - projectiles->width/2.0f);
+    projectiles->y[index] = toCoord(y);
+    projectiles->alive[index] = 1;
+    return index;
+}
+
+Rectangle projectileBounds(Projectiles *projectiles, int index) {
+    return (Rectangle){
+        .height=projectiles->height,
+        .width=projectiles->width,
+        .x=fromCoord(projectiles->x[index]),
+        .y=fromCoord(projectiles->y[index]),
+    };
+}
+
+// Everything the projectile covered on its way over the last step, from
+// where it was to where it is
+Rectangle sweptProjectileBounds(Projectiles *projectiles, int index) {
+    float travel = projectiles->travel;
+    float y = fromCoord(projectiles->y[index]);
+
+    return (Rectangle){
+        .height=projectiles->height + fabsf(travel),
+        .width=projectiles->width,
+        .x=fromCoord(projectiles->x[index]),
+        .y=travel > 0.0f ? y - travel : y,
+    };
+}
+
+void killProjectile(Projectiles *projectiles, int index) {
+    projectiles->alive[index] = 0;
+}
+
+void compactProjectiles(Projectiles *projectiles) {
+    Coord *restrict x = projectiles->x;
+    Coord *restrict y = projectiles->y;
+    uint8_t *restrict alive = projectiles->alive;
+    int *restrict remap = projectiles->remap;
+    const int count = projectiles->count;
+
+    // Every slot is copied down unconditionally and the write cursor only
+    // advances over survivors, so there is no branch to mispredict
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        uint8_t keep = alive[i];
+        x[kept] = x[i];
+        y[kept] = y[i];
+        alive[kept] = keep;
+        remap[i] = keep ? kept : -1;
+        kept += keep;
+    }
+    projectiles->count = kept;
+
+    // Compaction is stable, so the sorted order survives once dead slots are
+    // dropped and the rest renamed
+    int *order = projectiles->order;
+    int ordered = 0;
+    for (int i = 0; i < projectiles->ordered; ++i) {
+        int slot = remap[order[i]];
+        if (slot >= 0) order[ordered++] = slot;
+    }
+    projectiles->ordered = ordered;
 }
 
-void killPowerup(Entity *powerup) {
-    killProjectile(powerup);
+void clearProjectiles(Projectiles *projectiles) {
+    projectiles->count = 0;
+    projectiles->ordered = 0;
+    projectiles->travel = 0.0f;
 }
 
-void freeEntities(Entity *entity) {
-    Entity *current = entity;
-    Entity *next = current->next;
+// Slots added since the last call are appended and insertion sorted into
+// place, which is linear while only a few arrive per frame
+const int *sortProjectilesByX(Projectiles *projectiles) {
+    const Coord *x = projectiles->x;
+    int *order = projectiles->order;
 
-    while (next->type != LIST_SENTINEL) {
-        free(current);
-        current = next;
-        next = current->next;
+    for (int i = projectiles->ordered; i < projectiles->count; ++i) {
+        int slot = i;
+        int j = i;
+        while (j > 0 && x[order[j - 1]] > x[slot]) {
+            order[j] = order[j - 1];
+            --j;
+        }
+        order[j] = slot;
     }
-    free(current);
-    free(next);
-}
+    projectiles->ordered = projectiles->count;
 
-void freeHorde(Entity *entity) {
-    freeEntities(entity);
+    return order;
 }
 
-void freeBullets(Entity *entity) {
-    freeEntities(entity);
+void freeProjectiles(Projectiles *projectiles) {
+    free(projectiles->x);
+    free(projectiles->y);
+    free(projectiles->alive);
+    free(projectiles->order);
+    free(projectiles->remap);
+    free(projectiles);
 }
 
-void freePowerups(Entity *entity) {
-    freeEntities(entity);
+void freeHorde(Entity *entity) {
+    free(entity);
 }
 
 void freeShip(Entity *ship) {
@@ -3,25 +3,54 @@
 
 # include <stdlib.h>
 # include <string.h>
+# include <stdint.h>
+# include "level.h"
+# include "fixed.h"
 # include "raylib.h"
 
+# define HORDE_SIZE 55
+# define PROJECTILES_CAPACITY 4096
 
 typedef enum EntityType {
     PLAYER_SHIP,
     ALIEN,
-    FAST_SHOT,
     ENEMY_SHIP,
     LIST_SENTINEL,
-    BULLET,
-    FAST_MOVE,
 } EntityType;
 
+// Every kind of entity is defined once in these tables. The game expands
+// them into one pool and one set of update, collide and draw routines per
+// kind, so a hot loop only ever runs over a single kind.
+
+// X(kind, Name, texture)
+# define ALIEN_KINDS(X) \
+    X(TYPE1, Faster, alienFaster) \
+    X(TYPE2, Fast, alienFast) \
+    X(TYPE3, Slow, alienSlow)
+
+// X(kind, Name, width, height, up, texture, frame, effect)
+# define BULLET_KINDS(X) \
+    X(PLAYER_BULLET, PlayerBullets, 4.0f, 32.0f, true, bullet, bulletFrame, none) \
+    X(ENEMY_BULLET, EnemyBullets, 4.0f, 32.0f, false, bullet, bulletFrame, none)
+
+# define POWERUP_KINDS(X) \
+    X(SHOT_POWERUP, ShotPowerups, 25.0f, 25.0f, false, shotPowerup, powerupFrame, fastShot) \
+    X(MOVE_POWERUP, MovePowerups, 25.0f, 25.0f, false, movePowerup, powerupFrame, fastMove)
+
+# define PROJECTILE_KINDS(X) BULLET_KINDS(X) POWERUP_KINDS(X)
+
+# define KIND_ENUM(kind, ...) kind,
+
 typedef enum AlienTexture {
-    TYPE1,
-    TYPE2,
-    TYPE3,
+    ALIEN_KINDS(KIND_ENUM)
+    ALIEN_KIND_COUNT,
 } AlienTexture;
 
+typedef enum ProjectileKind {
+    PROJECTILE_KINDS(KIND_ENUM)
+    PROJECTILE_KIND_COUNT,
+} ProjectileKind;
+
 typedef struct Entity {
     Rectangle bounds;
     struct Entity *next;
@@ -29,40 +58,70 @@ typedef struct Entity {
     EntityType type;
     // Could be a union
     AlienTexture alienType;
-    bool up;
+    bool alive;
 } Entity;
 
+// Bullets and powerups only ever move vertically, so they are kept as
+// parallel arrays and integrated a whole pool at a time. A pool holds a
+// single kind, everything in it shares size and velocity. Positions are
+// Coords, packed integers in a FIXED_POINT build.
+typedef struct Projectiles {
+    Coord *x;
+    Coord *y;
+    // Byte mask rather than bool so the culling loop vectorizes
+    uint8_t *alive;
+    // Slots sorted by x. Projectiles never move sideways, so the order only
+    // changes when slots are added or compacted away and is kept up to date
+    // across frames instead of being rebuilt.
+    int *order;
+    int *remap;
+    int ordered;
+    int count;
+    int capacity;
+    float width;
+    float height;
+    // Signed, negative goes up
+    float velocity;
+    // How far the pool moved in its last step, collisions look back over it
+    float travel;
+} Projectiles;
+
 Entity *createPlayerShip();
 
+void resetPlayerShip(Entity *);
+
 Entity *createEnemyShip();
 
-Entity *createListEntities();
+void resetEnemyShip(Entity *);
 
 Entity *createHorde();
 
-Entity *findLastAlive(Entity *);
+// Returns the last alien standing, as relinkHorde does
+Entity *resetHorde(Entity *horde, const LevelWave *wave, int kindStart[]);
+
+Entity *relinkHorde(Entity *);
 
 void killEnemy(Entity *enemy);
 
-Entity *createBulletsList();
+Projectiles *createProjectiles(float width, float height, float velocity);
 
-void killProjectile(Entity *);
+int generateProjectile(Projectiles *, float x, float y);
 
-void generateBullet(Entity *list, float x, float y, bool up);
+Rectangle projectileBounds(Projectiles *, int index);
 
-void killBullet(Entity *);
+Rectangle sweptProjectileBounds(Projectiles *, int index);
 
-Entity *createPowerupsList();
+void killProjectile(Projectiles *, int index);
 
-void generatePowerup(Entity *list, float x, float y);
+void compactProjectiles(Projectiles *);
 
-void killPowerup(Entity *);
+void clearProjectiles(Projectiles *);
 
-void freeHorde(Entity *);
+const int *sortProjectilesByX(Projectiles *);
 
-void freeBullets(Entity *);
+void freeProjectiles(Projectiles *);
 
-void freePowerups(Entity *);
+void freeHorde(Entity *);
 
 void freeShip(Entity *);
 
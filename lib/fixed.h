@@ -0,0 +1,56 @@
+# ifndef _FIXED_H_
+# define _FIXED_H_
+
+# include <stdint.h>
+# include <math.h>
+
+// Building with -DFIXED_POINT keeps projectile positions as integers and
+// moves everything else on the same grid. Ships and aliens still live in
+// raylib Rectangles, but their positions only ever hold a whole number of
+// Coord units, which a float stores exactly, and every move is an integer
+// add of a whole number of units per step. Together with the fixed step
+// that makes a run come out the same on every compiler and CPU.
+# ifdef FIXED_POINT
+
+// What float math is left must not be fused into FMAs, only some CPUs have
+// them and they round differently
+# if defined(__clang__)
+# pragma STDC FP_CONTRACT OFF
+# elif defined(__GNUC__)
+# pragma GCC optimize ("fp-contract=off")
+# endif
+
+// Q11.4, sixteenths of a pixel. Covers -2048 up to 2047 pixels, the screen
+// plus the margin projectiles get culled in.
+# define COORD_SHIFT 4
+
+typedef int16_t Coord;
+
+static inline Coord toCoord(float value) {
+    return (Coord)lrintf(value*(1 << COORD_SHIFT));
+}
+
+static inline float fromCoord(Coord coord) {
+    return (float)coord/(1 << COORD_SHIFT);
+}
+
+# else
+
+typedef float Coord;
+
+static inline Coord toCoord(float value) {
+    return value;
+}
+
+static inline float fromCoord(Coord coord) {
+    return coord;
+}
+
+# endif
+
+// Moves a position kept in a float by a whole number of Coord units
+static inline float moveCoord(float position, Coord distance) {
+    return fromCoord(toCoord(position) + distance);
+}
+
+# endif
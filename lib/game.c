@@ -1,26 +1,28 @@
 # include <string.h>
 # include <stdio.h>
 # include <time.h>
+# include <math.h>
 # include "game.h"
 # include "raylib.h"
 
 
 void detectCollisions(Game *);
 
+// Snapshots carry the projectile kind in two bits
+_Static_assert(PROJECTILE_KIND_COUNT <= 4, "projectile kinds don't fit the snapshot encoding");
+
 ColdGameData *initColdGameData() {  
     const float shipSpeeds[] = {300.0f, 450.0f};
     const float shipDelaysToFire[] = {0.5f, 0.1f};
     const float screenLimits[] = {250.0f, 1670.0f};
 
     ColdGameData *gameData = (ColdGameData *)malloc(sizeof(ColdGameData));
-    gameData->enemyShipDelayToFire = 0.25f;
     gameData->enemyShipSpeed = 450.0f;
     gameData->projectileSpeed = 600.0f;
     gameData->powerupDuration = 2.0f;
-    gameData->hordeSpeedIncrease = 25.0f;
-    gameData->hordeStepY = 100.0f;
-    gameData->enemyShipSleepTime = 4.0f;
     gameData->alienTimePerFrame = 0.1f;
+    gameData->timeScale = 1.0f;
+    gameData->bulletInterception = false;
     
     memcpy(
         &gameData->shipSpeeds,
@@ -37,10 +39,8 @@ ColdGameData *initColdGameData() {
     return gameData;
 }
 
-HotGameData *initHotGameData() {
-    HotGameData *gameData = (HotGameData *)malloc(sizeof(HotGameData));
-    gameData->lastFrameTime = GetTime();
-    gameData->hordeSpeed = 100.0f;
+// Wave related fields are filled in by startWave()
+void resetHotGameData(HotGameData *gameData) {
     gameData->gameState = MENU;
     gameData->menuButton = START;
     gameData->enemyShipGoingLeft = true;
@@ -48,27 +48,35 @@ HotGameData *initHotGameData() {
     gameData->enemyShipDefeated = false;
     gameData->fastMoveActive = false;
     gameData->fastShotActive = false;
-    gameData->shipLastShotTime = 0.0;
-    gameData->remainingTimeEnemyShipAlarm = 4.0f;
-    gameData->enemyShipLastShotTime = 0.0;
+    gameData->simTicks = 0;
+    gameData->fastShotTimer = NO_TIMER;
+    gameData->fastMoveTimer = NO_TIMER;
+    gameData->enemyShipTimer = NO_TIMER;
+    gameData->shipLoaded = true;
+    gameData->enemyShipLoaded = true;
     gameData->shipActive = true;
     gameData->input = (Input){.fire=false};
+}
+
+HotGameData *initHotGameData() {
+    HotGameData *gameData = (HotGameData *)malloc(sizeof(HotGameData));
+    resetHotGameData(gameData);
 
     return gameData;
 }
 
-Sounds *initSounds() {
+Sounds *initSounds(SoundCache *cache) {
     Sounds *sounds = (Sounds *)malloc(sizeof(Sounds));
     sounds->background = LoadMusicStream("assets/sounds/background.ogg");
     sounds->enemyShip = LoadMusicStream("assets/sounds/enemyShip.ogg");
-    sounds->shipFire = LoadSound("assets/sounds/shipFire.ogg");
-    sounds->enemyFire = LoadSound("assets/sounds/alienFire.ogg");
-    sounds->shipExplosion = LoadSound("assets/sounds/shipExplosion.ogg");
-    sounds->enemyExplosion = LoadSound("assets/sounds/alienExplosion.ogg");
-    sounds->powerup = LoadSound("assets/sounds/powerup.ogg");
-    sounds->lose = LoadSound("assets/sounds/lose.ogg");
-    sounds->victory = LoadSound("assets/sounds/victory.ogg");
-    sounds->menu = LoadSound("assets/sounds/menu.ogg");
+    sounds->shipFire = loadSoundEffect(cache, "assets/sounds/shipFire.ogg", 4);
+    sounds->enemyFire = loadSoundEffect(cache, "assets/sounds/alienFire.ogg", 6);
+    sounds->shipExplosion = loadSoundEffect(cache, "assets/sounds/shipExplosion.ogg", 2);
+    sounds->enemyExplosion = loadSoundEffect(cache, "assets/sounds/alienExplosion.ogg", 8);
+    sounds->powerup = loadSoundEffect(cache, "assets/sounds/powerup.ogg", 2);
+    sounds->lose = loadSoundEffect(cache, "assets/sounds/lose.ogg", 1);
+    sounds->victory = loadSoundEffect(cache, "assets/sounds/victory.ogg", 1);
+    sounds->menu = loadSoundEffect(cache, "assets/sounds/menu.ogg", 2);
 
     return sounds;
 }
@@ -76,52 +84,88 @@ Sounds *initSounds() {
 void cleanupSounds(Sounds *sounds) {
     UnloadMusicStream(sounds->background);
     UnloadMusicStream(sounds->enemyShip);
-    UnloadSound(sounds->shipFire);
-    UnloadSound(sounds->enemyFire);
-    UnloadSound(sounds->shipExplosion);
-    UnloadSound(sounds->enemyExplosion);
-    UnloadSound(sounds->powerup);
-    UnloadSound(sounds->lose);
-    UnloadSound(sounds->victory);
-    UnloadSound(sounds->menu);
+    unloadSoundEffect(&sounds->shipFire);
+    unloadSoundEffect(&sounds->enemyFire);
+    unloadSoundEffect(&sounds->shipExplosion);
+    unloadSoundEffect(&sounds->enemyExplosion);
+    unloadSoundEffect(&sounds->powerup);
+    unloadSoundEffect(&sounds->lose);
+    unloadSoundEffect(&sounds->victory);
+    unloadSoundEffect(&sounds->menu);
     free(sounds);
 }
 
-Textures *initTextures() {
+Textures *initTextures(RenderBackend *renderer) {
     Textures *textures = (Textures *)malloc(sizeof(Textures));
-    textures->ship = LoadTexture("assets/textures/ship.png");
-    textures->enemyShip = LoadTexture("assets/textures/enemyShip.png");
-    textures->alienSlow = LoadTexture("assets/textures/alienSlow.png");
-    textures->alienFast = LoadTexture("assets/textures/alienFast.png");
-    textures->alienFaster = LoadTexture("assets/textures/alienFaster.png");
-    textures->bullet = LoadTexture("assets/textures/bullet.png");
-    textures->shotPowerup = LoadTexture("assets/textures/shotPowerup.png");
-    textures->movePowerup = LoadTexture("assets/textures/movePowerup.png");
+    textures->ship = renderer->loadTexture(renderer, "assets/textures/ship.png");
+    textures->enemyShip = renderer->loadTexture(renderer, "assets/textures/enemyShip.png");
+    textures->alienSlow = renderer->loadTexture(renderer, "assets/textures/alienSlow.png");
+    textures->alienFast = renderer->loadTexture(renderer, "assets/textures/alienFast.png");
+    textures->alienFaster = renderer->loadTexture(renderer, "assets/textures/alienFaster.png");
+    textures->bullet = renderer->loadTexture(renderer, "assets/textures/bullet.png");
+    textures->shotPowerup = renderer->loadTexture(renderer, "assets/textures/shotPowerup.png");
+    textures->movePowerup = renderer->loadTexture(renderer, "assets/textures/movePowerup.png");
 
     return textures;
 }
 
-void cleanupTextures(Textures *textures) {
-    UnloadTexture(textures->ship);
-    UnloadTexture(textures->enemyShip);
-    UnloadTexture(textures->alienSlow);
-    UnloadTexture(textures->alienFast);
-    UnloadTexture(textures->alienFaster);
-    UnloadTexture(textures->bullet);
-    UnloadTexture(textures->shotPowerup);
-    UnloadTexture(textures->movePowerup);
+void cleanupTextures(Textures *textures, RenderBackend *renderer) {
+    renderer->unloadTexture(renderer, textures->ship);
+    renderer->unloadTexture(renderer, textures->enemyShip);
+    renderer->unloadTexture(renderer, textures->alienSlow);
+    renderer->unloadTexture(renderer, textures->alienFast);
+    renderer->unloadTexture(renderer, textures->alienFaster);
+    renderer->unloadTexture(renderer, textures->bullet);
+    renderer->unloadTexture(renderer, textures->shotPowerup);
+    renderer->unloadTexture(renderer, textures->movePowerup);
     free(textures);
 }
 
-Animation *initAnimation() {
-    Animation *animation = (Animation *)malloc(sizeof(Animation));
+void resetAnimation(Animation *animation) {
     animation->aliensFrame = (Rectangle){.height=16.0f, .width=16.0f, .x=0.0f, .y=0.0f};
     animation->shipFrame = (Rectangle){.height=12.0f, .width=16.0f, .x=0.0f, .y=0.0f};
     animation->bulletFrame = (Rectangle){.height=8.0f, .width=4.0f, .x=0.0f, .y=0.0f};
     animation->enemyShipFrame = (Rectangle){.height=10.0f, .width=16.0f, .x=0.0f, .y=0.0f};
     animation->powerupFrame = (Rectangle){.height=18.0f, .width=18.0f, .x=0.0f, .y=0.0f};
-    animation->timeRemainingToChangeFrame = 0.1f;
     animation->enemyCurrentFrame = 0;
+}
+
+// Built against the sizes the entities are drawn at, so a hit test never
+// has to scale anything
+Masks *initMasks(Game *game) {
+    Masks *masks = (Masks *)malloc(sizeof(Masks));
+    Animation *animation = game->animation;
+    Rectangle alien = game->horde[1].bounds;
+
+    masks->ship = loadMaskSheet("assets/textures/ship.png", animation->shipFrame, game->ship->bounds.width, game->ship->bounds.height);
+    masks->enemyShip = loadMaskSheet("assets/textures/enemyShip.png", animation->enemyShipFrame, game->enemyShip->bounds.width, game->enemyShip->bounds.height);
+# define LOAD_ALIEN_MASK(kind, Name, texture) \
+    masks->aliens[kind] = loadMaskSheet("assets/textures/" #texture ".png", animation->aliensFrame, alien.width, alien.height);
+    ALIEN_KINDS(LOAD_ALIEN_MASK)
+# undef LOAD_ALIEN_MASK
+# define LOAD_PROJECTILE_MASK(kind, Name, width, height, up, texture, frame, effect) \
+    masks->projectiles[kind] = loadMaskSheet("assets/textures/" #texture ".png", animation->frame, width, height);
+    PROJECTILE_KINDS(LOAD_PROJECTILE_MASK)
+# undef LOAD_PROJECTILE_MASK
+
+    return masks;
+}
+
+void cleanupMasks(Masks *masks) {
+    unloadMaskSheet(&masks->ship);
+    unloadMaskSheet(&masks->enemyShip);
+    for (int kind = 0; kind < ALIEN_KIND_COUNT; ++kind) {
+        unloadMaskSheet(&masks->aliens[kind]);
+    }
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        unloadMaskSheet(&masks->projectiles[kind]);
+    }
+    free(masks);
+}
+
+Animation *initAnimation() {
+    Animation *animation = (Animation *)malloc(sizeof(Animation));
+    resetAnimation(animation);
 
     return animation;
 }
@@ -130,68 +174,166 @@ void cleanupAnimation(Animation *animation) {
     free(animation);
 }
 
+uint64_t hashAlienSlot(int index) {
+    return mixHash((uint64_t)index + 1);
+}
+
+void hashFormation(Game *game) {
+    game->hash.aliveSet = 0;
+    for (int i = 0; i < HORDE_SIZE; ++i) {
+        if (game->horde[i + 1].alive) game->hash.aliveSet ^= hashAlienSlot(i);
+    }
+}
+
+uint32_t secondsToTicks(double seconds) {
+    return (uint32_t)ceil(seconds*TIMER_TICK_RATE);
+}
+
+double timerSeconds(Game *game, TimerHandle handle) {
+    return (double)timerRemaining(game->timers, handle)/TIMER_TICK_RATE;
+}
+
+// Whatever *handle pointed at is dropped, a timer only takes its place when
+// there is time left to run
+void restartTimer(Game *game, TimerHandle *handle, double seconds, TimerEvent event, int payload) {
+    cancelTimer(game->timers, *handle);
+    *handle = seconds > 0.0 ? scheduleTimer(game->timers, secondsToTicks(seconds), event, payload) : NO_TIMER;
+}
+
+const LevelWave *currentWave(Game *game) {
+    return &game->level->waves[game->hotData->wave];
+}
+
+// Lays the next wave out over the storage the last one used, so moving on
+// allocates nothing and costs no more than a restart of the formation
+void startWave(Game *game, int wave) {
+    HotGameData *hotData = game->hotData;
+    hotData->wave = wave;
+    const LevelWave *levelWave = currentWave(game);
+
+    game->hordeLastAlive = resetHorde(game->horde, levelWave, game->alienKindStart);
+    hashFormation(game);
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        clearProjectiles(game->projectiles[kind]);
+    }
+
+    resetBunkers(game->bunkers);
+    resetEnemyShip(game->enemyShip);
+    hotData->hordeSpeed = levelWave->hordeSpeed;
+    restartTimer(game, &hotData->enemyShipTimer, levelWave->enemyShipSleepTime, TIMER_ENEMY_SHIP_ARRIVES, 0);
+    hotData->enemyShipGoingLeft = true;
+    hotData->enemyShipActive = false;
+    hotData->enemyShipDefeated = false;
+    StopMusicStream(game->sounds->enemyShip);
+}
+
 void initGame(Game *game) {
     game->ship = createPlayerShip();
     game->enemyShip = createEnemyShip();
-    game->bullets = createBulletsList();
-    game->powerups = createPowerupsList();
     game->hotData = initHotGameData();
     game->coldData = initColdGameData();
-    game->sounds = initSounds();
-    game->textures = initTextures();
+    const float speed = game->coldData->projectileSpeed;
+# define CREATE_PROJECTILES(kind, Name, width, height, up, ...) \
+    game->projectiles[kind] = createProjectiles(width, height, (up) ? -speed : speed);
+    PROJECTILE_KINDS(CREATE_PROJECTILES)
+# undef CREATE_PROJECTILES
+    game->bulletHits = (int *)malloc(game->projectiles[PLAYER_BULLET]->capacity*sizeof(int));
+    game->particles = createParticleSystem();
+    // Without an audio device every sound stays empty, playing one does nothing
+    game->sounds = game->headless ? (Sounds *)calloc(1, sizeof(Sounds)) : initSounds(game->soundCache);
+    game->textures = initTextures(game->renderer);
+    game->bunkers = createBunkers(
+        BUNKER_COUNT,
+        780.0f,
+        game->coldData->screenLimits[0],
+        game->coldData->screenLimits[1],
+        game->renderer
+    );
     game->animation = initAnimation();
-    game->horde = createHorde(game->hordeLastAlive);
-    game->hordeLastAlive = findLastAlive(game->horde);
+    game->horde = createHorde();
+    game->timers = createTimerWheel();
+    scheduleTimer(game->timers, secondsToTicks(game->coldData->alienTimePerFrame), TIMER_ALIEN_FRAME, 0);
 
     game->sounds->background.looping = true;
     game->sounds->enemyShip.looping = true;
+    startWave(game, 0);
+    game->masks = initMasks(game);
     PlayMusicStream(game->sounds->background);
 }
 
 void cleanupGame(Game *game) {
-    cleanupSounds(game->sounds);
-    cleanupTextures(game->textures);
+    if (game->headless) {
+        free(game->sounds);
+    } else {
+        cleanupSounds(game->sounds);
+    }
+    cleanupTextures(game->textures, game->renderer);
+    cleanupMasks(game->masks);
     cleanupAnimation(game->animation);
     freeShip(game->ship);
     freeEnemyShip(game->enemyShip);
     freeHorde(game->horde);
-    freeBullets(game->bullets);
-    freePowerups(game->powerups);
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        freeProjectiles(game->projectiles[kind]);
+    }
+    freeParticleSystem(game->particles);
+    freeBunkers(game->bunkers, game->renderer);
+    free(game->bulletHits);
+    freeTimerWheel(game->timers);
     free(game->hotData);
     free(game->coldData);
 }
 
+// Resets in place, the pools from the first start are reused as they are
 void rebootGame(Game *game) {
-    cleanupGame(game);
-    initGame(game);
+    resetHotGameData(game->hotData);
+    resetTimerWheel(game->timers);
+    scheduleTimer(game->timers, secondsToTicks(game->coldData->alienTimePerFrame), TIMER_ALIEN_FRAME, 0);
+    resetAnimation(game->animation);
+    resetPlayerShip(game->ship);
+    startWave(game, 0);
+    PlayMusicStream(game->sounds->background);
     game->hotData->gameState = PLAYING;
 }
 
-void fire(Game *game, Entity *entity) {
-    double now = GetTime();
-    if (entity->type == PLAYER_SHIP) {
-        float delayToFire;
-        if (game->hotData->fastShotActive) {
-            delayToFire = game->coldData->shipDelaysToFire[BUFFED];
-        } else {
-            delayToFire = game->coldData->shipDelaysToFire[REGULAR];
-        }
-
-        if (now - game->hotData->shipLastShotTime > delayToFire) {
-            generateBullet(game->bullets, entity->bounds.x + entity->bounds.width/2.0f, entity->bounds.y, true);
-            game->hotData->shipLastShotTime = now;
-        }
-    } else if (entity->type == ENEMY_SHIP) {
-        if (now - game->hotData->enemyShipLastShotTime > game->coldData->enemyShipDelayToFire) {
-            generateBullet(game->bullets, entity->bounds.x + entity->bounds.width/2.0f, entity->bounds.y + entity->bounds.height, false);
-            game->hotData->enemyShipLastShotTime = now;
-        }
+void fireShip(Game *game) {
+    Entity *ship = game->ship;
+    float delayToFire;
+    if (game->hotData->fastShotActive) {
+        delayToFire = game->coldData->shipDelaysToFire[BUFFED];
     } else {
-        generateBullet(game->bullets, entity->bounds.x + entity->bounds.width/2.0f, entity->bounds.y + entity->bounds.height, false);
-        PlaySound(game->sounds->enemyFire);
+        delayToFire = game->coldData->shipDelaysToFire[REGULAR];
+    }
+
+    if (game->hotData->shipLoaded) {
+        generateProjectile(game->projectiles[PLAYER_BULLET], ship->bounds.x + ship->bounds.width/2.0f, ship->bounds.y);
+        game->hotData->shipLoaded = false;
+        scheduleTimer(game->timers, secondsToTicks(delayToFire), TIMER_SHIP_RELOADED, 0);
+        game->frameStats.shots++;
     }
 }
 
+void fireEnemyShip(Game *game) {
+    Entity *enemyShip = game->enemyShip;
+    if (game->hotData->enemyShipLoaded) {
+        generateProjectile(game->projectiles[ENEMY_BULLET], enemyShip->bounds.x + enemyShip->bounds.width/2.0f, enemyShip->bounds.y + enemyShip->bounds.height);
+        game->hotData->enemyShipLoaded = false;
+        scheduleTimer(game->timers, secondsToTicks(currentWave(game)->enemyShipDelayToFire), TIMER_ENEMY_SHIP_RELOADED, 0);
+        game->frameStats.shots++;
+    }
+}
+
+void fireAlien(Game *game, Entity *alien) {
+    generateProjectile(game->projectiles[ENEMY_BULLET], alien->bounds.x + alien->bounds.width/2.0f, alien->bounds.y + alien->bounds.height);
+    playSoundEffect(&game->sounds->enemyFire);
+    game->frameStats.shots++;
+}
+
+void dropPowerup(Game *game, float x, float y) {
+    int dropCheck = randomBelow(&game->hotData->random, 100);
+    generateProjectile(game->projectiles[dropCheck < 50 ? MOVE_POWERUP : SHOT_POWERUP], x, y);
+}
+
 void processInput(Input *input) {
     float stickX = 0.0f, stickY = 0.0f;
     const float stickDeadzone = 0.1f;
@@ -209,180 +351,306 @@ void processInput(Input *input) {
     input->fire = IsKeyPressed(KEY_SPACE) || (IsGamepadAvailable(0) && IsGamepadButtonPressed(0, GAMEPAD_BUTTON_RIGHT_FACE_DOWN));
     input->select = IsKeyPressed(KEY_ENTER) || (IsGamepadAvailable(0) && IsGamepadButtonPressed(0, GAMEPAD_BUTTON_RIGHT_FACE_RIGHT));
     input->pause = IsKeyPressed(KEY_ESCAPE) || (IsGamepadAvailable(0) && IsGamepadButtonPressed(0, GAMEPAD_BUTTON_MIDDLE_RIGHT));
+    input->rewind = IsKeyDown(KEY_BACKSPACE) || (IsGamepadAvailable(0) && IsGamepadButtonDown(0, GAMEPAD_BUTTON_LEFT_TRIGGER_1));
+}
+
+void explode(Game *game, Rectangle bounds, int amount, Color color) {
+    spawnExplosion(
+        game->particles,
+        bounds.x + bounds.width/2.0f,
+        bounds.y + bounds.height/2.0f,
+        amount,
+        bounds.width*4.0f,
+        color
+    );
+}
+
+// Without an evdev sampler raylib is read once per frame on this thread.
+// Its state only changes in the poll at the end of EndDrawing, so a sample
+// cannot say when a key went down and latency goes unmeasured.
+void sampleInput(Game *game) {
+    Input input;
+    processInput(&input);
+    pushInputSample(game->inputQueue, input, 0.0);
+}
+
+bool isInputActive(Input input) {
+    return input.left || input.right || input.fire || input.select ||
+        input.up || input.down || input.pause || input.rewind;
+}
+
+// What stays down from one sample to the next, everything else is a press
+// that happens once
+Input heldButtons(Input input) {
+    return (Input){.left=input.left, .right=input.right, .rewind=input.rewind};
+}
+
+void drainInput(Game *game) {
+    InputLatency *latency = game->inputLatency;
+    // The sampler only pushes changes, held keys stay down in between
+    Input merged = heldButtons(game->heldInput);
+    InputSample sample;
+    double now = inputClock();
+    // evdev hears every keyboard on the system whatever window has focus,
+    // typing into another one must not play the game. Held keys are still
+    // followed so they are right once focus comes back.
+    bool focused = game->inputSampler == NULL || IsWindowFocused();
+
+    while (popInputSample(game->inputQueue, &sample)) {
+        // Presses accumulate so none is lost between ticks, held keys take
+        // the latest state
+        merged.fire |= sample.input.fire;
+        merged.select |= sample.input.select;
+        merged.up |= sample.input.up;
+        merged.down |= sample.input.down;
+        merged.pause |= sample.input.pause;
+        merged.left = sample.input.left;
+        merged.right = sample.input.right;
+        merged.rewind = sample.input.rewind;
+
+        if (focused && game->inputSampler != NULL && isInputActive(sample.input)) {
+            recordLatency(&latency->toSimulation, now - sample.sampledAt);
+            if (!latency->pendingPresent) {
+                latency->pendingPresent = true;
+                latency->oldestUnpresented = sample.sampledAt;
+            }
+        }
+    }
+
+    game->heldInput = merged;
+    game->hotData->input = focused ? merged : (Input){.left=false};
+}
+
+void reportInputLatency(InputLatency *latency) {
+    if (latency->toSimulation.count == 0) return;
+
+    TraceLog(
+        LOG_INFO,
+        "INPUT: to simulation p50 %.2fms p95 %.2fms p99 %.2fms, to present p50 %.2fms p95 %.2fms p99 %.2fms (%u samples)",
+        latencyPercentile(&latency->toSimulation, 0.50)*1000.0,
+        latencyPercentile(&latency->toSimulation, 0.95)*1000.0,
+        latencyPercentile(&latency->toSimulation, 0.99)*1000.0,
+        latencyPercentile(&latency->toPresent, 0.50)*1000.0,
+        latencyPercentile(&latency->toPresent, 0.95)*1000.0,
+        latencyPercentile(&latency->toPresent, 0.99)*1000.0,
+        latency->toSimulation.count
+    );
+    resetLatency(&latency->toSimulation);
+    resetLatency(&latency->toPresent);
+}
+
+void presentInput(Game *game, double presentedAt) {
+    InputLatency *latency = game->inputLatency;
+
+    if (latency->pendingPresent) {
+        recordLatency(&latency->toPresent, presentedAt - latency->oldestUnpresented);
+        latency->pendingPresent = false;
+    }
+    if (presentedAt - latency->lastReport >= LATENCY_REPORT_INTERVAL) {
+        reportInputLatency(latency);
+        latency->lastReport = presentedAt;
+    }
+}
+
+// How far speed pixels per second carries in one step. A FIXED_POINT build
+// rounds it to whole Coord units, the one multiply is the same everywhere.
+Coord stepDistance(Game *game, float speed) {
+    return toCoord(speed*game->stepDelta);
 }
 
 void updateShip(Game *game) {
     if (game->hotData->gameState == PLAYING) {
         Entity *ship = game->ship;
         Input input = game->hotData->input;
-        double now = GetTime();
-        double delta = now - game->hotData->lastFrameTime;
-
-        if (game->hotData->fastShotActive) {
-            game->hotData->fastShotRemainingTime -= delta;
-            if (game->hotData->fastShotRemainingTime <= 0.0) game->hotData->fastShotActive = false;
-        }
-
-        if (game->hotData->fastMoveActive) {
-            game->hotData->fastMoveRemainingTime -= delta;
-            if (game->hotData->fastMoveRemainingTime <= 0.0) game->hotData->fastMoveActive = false;
-        }
+        Coord step = stepDistance(game, game->coldData->shipSpeeds[game->hotData->fastMoveActive ? BUFFED : REGULAR]);
+        Coord x = toCoord(ship->bounds.x);
 
         if (input.right) {
-            if (game->hotData->fastMoveActive) {
-                if (ship->bounds.x + ship->bounds.width + game->coldData->shipSpeeds[BUFFED]*delta >= game->coldData->screenLimits[1]) {
-                    ship->bounds.x = game->coldData->screenLimits[1] - ship->bounds.width;
-                } else {
-                    ship->bounds.x += game->coldData->shipSpeeds[BUFFED]*delta;
-                }
-            }
-            else {
-                if (ship->bounds.x + ship->bounds.width + game->coldData->shipSpeeds[REGULAR]*delta >= game->coldData->screenLimits[1]) {
-                    ship->bounds.x = game->coldData->screenLimits[1] - ship->bounds.width;
-                } else {
-                    ship->bounds.x += game->coldData->shipSpeeds[REGULAR]*delta;
-                }
-            }
+            Coord limit = toCoord(game->coldData->screenLimits[1] - ship->bounds.width);
+            x = x + step >= limit ? limit : x + step;
         }
         if (input.left) {
-            if (game->hotData->fastMoveActive) {
-                if (ship->bounds.x - game->coldData->shipSpeeds[BUFFED]*delta <= game->coldData->screenLimits[0]) {
-                    ship->bounds.x = game->coldData->screenLimits[0];
-                } else {
-                    ship->bounds.x -= game->coldData->shipSpeeds[BUFFED]*delta;
-                }
-            } else {
-                if (ship->bounds.x - game->coldData->shipSpeeds[REGULAR]*delta <= game->coldData->screenLimits[0]) {
-                    ship->bounds.x = game->coldData->screenLimits[0];
-                } else {
-                    ship->bounds.x -= game->coldData->shipSpeeds[REGULAR]*delta;
-                }
-            }
+            Coord limit = toCoord(game->coldData->screenLimits[0]);
+            x = x - step <= limit ? limit : x - step;
         }
+        ship->bounds.x = fromCoord(x);
 
         if (input.fire) {
-            fire(game, ship);
+            fireShip(game);
+        }
+    }
+}
+
+// The horde is too small to be worth splitting across the job system, a
+// chunk would not even fill one of the smallest job runs
+float hordeExtent(Entity *aliens, bool goingRight) {
+    float extent = goingRight ? -INFINITY : INFINITY;
+
+    for (int i = 0; i < HORDE_SIZE; ++i) {
+        Entity *alien = &aliens[i];
+        if (!alien->alive) continue;
+        if (goingRight) {
+            extent = alien->bounds.x > extent ? alien->bounds.x : extent;
+        } else {
+            extent = alien->bounds.x < extent ? alien->bounds.x : extent;
         }
     }
+
+    return extent;
+}
+
+void moveHorde(Entity *aliens, Coord movement, Coord stepY) {
+    // Dead aliens move along too, nothing reads them and it keeps the loop flat
+    for (int i = 0; i < HORDE_SIZE; ++i) {
+        aliens[i].bounds.x = moveCoord(aliens[i].bounds.x, movement);
+        aliens[i].bounds.y = moveCoord(aliens[i].bounds.y, stepY);
+    }
 }
 
 void updateHorde(Game *game) {
     if (game->hotData->gameState == PLAYING) {
-        Entity *current = game->horde->next;
-        double now = GetTime();
-        double delta = now - game->hotData->lastFrameTime;
-
-        game->animation->timeRemainingToChangeFrame -= delta;
-        if (game->animation->timeRemainingToChangeFrame < 0.0f) {
-            game->animation->enemyCurrentFrame = (game->animation->enemyCurrentFrame + 1) % 4;
-            game->animation->aliensFrame.x = game->animation->aliensFrame.x + game->animation->aliensFrame.width *  game->animation->enemyCurrentFrame;
-            game->animation->timeRemainingToChangeFrame = game->coldData->alienTimePerFrame;
-        }
+        Entity *aliens = &game->horde[1];
+        const bool goingRight = game->hotData->hordeSpeed > 0.0f;
+        const Coord step = stepDistance(game, game->hotData->hordeSpeed);
 
         bool changeDirection = false;
-        float maxMovement;
-        if (game->hotData->hordeSpeed > 0.0f) {
-            float maxPositionX = current->bounds.x;
-            while (current->type != LIST_SENTINEL) {
-                maxPositionX = current->bounds.x > maxPositionX ? current->bounds.x : maxPositionX;
-                current = current->next;
-            }
+        Coord maxMovement;
+        if (goingRight) {
+            Coord maxPositionX = toCoord(hordeExtent(aliens, goingRight));
+            Coord limit = toCoord(game->coldData->screenLimits[1] - game->horde->next->bounds.width);
 
-            if (maxPositionX + game->hotData->hordeSpeed*delta + game->horde->next->bounds.width >= game->coldData->screenLimits[1]) {
-                maxMovement = 2.0f*game->hotData->hordeSpeed*delta - game->coldData->screenLimits[1] + maxPositionX + game->horde->next->bounds.width;
+            if (maxPositionX + step >= limit) {
+                maxMovement = 2*step - limit + maxPositionX;
                 changeDirection = true;
                 game->hotData->hordeSpeed *= -1;
-                game->hotData->hordeSpeed -= game->coldData->hordeSpeedIncrease;
+                game->hotData->hordeSpeed -= currentWave(game)->hordeSpeedIncrease;
             } else {
-                maxMovement = game->hotData->hordeSpeed*delta;
+                maxMovement = step;
             }
         } else {
-            float minPositionX = current->bounds.x;
-            while (current->type != LIST_SENTINEL) {
-                minPositionX = current->bounds.x < minPositionX ? current->bounds.x : minPositionX;
-                current = current->next;
-            }
-            if (minPositionX + game->hotData->hordeSpeed*delta <= game->coldData->screenLimits[0]) {
-                maxMovement = minPositionX - game->coldData->screenLimits[0];
+            Coord minPositionX = toCoord(hordeExtent(aliens, goingRight));
+            Coord limit = toCoord(game->coldData->screenLimits[0]);
+
+            if (minPositionX + step <= limit) {
+                maxMovement = minPositionX - limit;
                 changeDirection = true;
                 game->hotData->hordeSpeed *= -1;
-                game->hotData->hordeSpeed += game->coldData->hordeSpeedIncrease;
+                game->hotData->hordeSpeed += currentWave(game)->hordeSpeedIncrease;
             } else {
-                maxMovement = game->hotData->hordeSpeed*delta;
+                maxMovement = step;
             }
         }
-    
+
+        // Rolls have to be drawn in formation order for runs to be reproducible,
+        // so firing stays on this thread and, as before, happens before the move
+        const LevelWave *wave = currentWave(game);
         for (Entity *current = game->horde->next; current->type != LIST_SENTINEL; current = current->next) {
-            int dropCheck = rand() % 1000000;
-            if (dropCheck < 10) fire(game, current);
-            current->bounds.x += maxMovement;
-            
-            if (changeDirection) {
-                current->bounds.y += game->coldData->hordeStepY;
-            }
+            int dropCheck = randomBelow(&game->hotData->random, 1000000);
+            if (dropCheck < wave->fireChance) fireAlien(game, current);
         }
+
+        moveHorde(aliens, maxMovement, changeDirection ? toCoord(wave->hordeStepY) : 0);
     }
 }
 
 void updateEnemyShip(Game *game) {
-    if (!game->hotData->enemyShipDefeated && !game->hotData->enemyShipActive) {
-        game->hotData->remainingTimeEnemyShipAlarm -= GetTime() - game->hotData->lastFrameTime;
-        if (game->hotData->remainingTimeEnemyShipAlarm <= 0.0) {
-            game->hotData->enemyShipActive = true;
-            PlayMusicStream(game->sounds->enemyShip);
-        }
-    } else if (game->hotData->enemyShipActive && !game->hotData->enemyShipDefeated) {
+    if (game->hotData->enemyShipActive && !game->hotData->enemyShipDefeated) {
         Entity *enemyShip = game->enemyShip;
-        const float enemyShipMove = game->coldData->enemyShipSpeed*(GetTime() - game->hotData->lastFrameTime);
-        fire(game, game->enemyShip);
+        const Coord enemyShipMove = stepDistance(game, game->coldData->enemyShipSpeed);
+        const Coord x = toCoord(enemyShip->bounds.x);
+        fireEnemyShip(game);
     
         UpdateMusicStream(game->sounds->enemyShip);
         if (game->hotData->enemyShipGoingLeft) {
-            if (enemyShip->bounds.x - enemyShipMove <= game->coldData->screenLimits[0]) {
+            if (x - enemyShipMove <= toCoord(game->coldData->screenLimits[0])) {
                 enemyShip->bounds.x = game->coldData->screenLimits[0];
                 game->hotData->enemyShipGoingLeft = false;
             } else {
-                enemyShip->bounds.x -= enemyShipMove;
+                enemyShip->bounds.x = fromCoord(x - enemyShipMove);
             }
         } else {
-            if (enemyShip->bounds.x + enemyShipMove >= game->screenWidth) {
+            if (x + enemyShipMove >= toCoord(game->screenWidth)) {
                 enemyShip->bounds.x = game->screenWidth;
                 game->hotData->enemyShipGoingLeft = true;
-                game->hotData->remainingTimeEnemyShipAlarm = game->coldData->enemyShipSleepTime;
+                restartTimer(game, &game->hotData->enemyShipTimer, currentWave(game)->enemyShipSleepTime, TIMER_ENEMY_SHIP_ARRIVES, 0);
                 game->hotData->enemyShipActive = false;
                 StopMusicStream(game->sounds->enemyShip);
             } else {
-                enemyShip->bounds.x += enemyShipMove;
+                enemyShip->bounds.x = fromCoord(x + enemyShipMove);
             }
         }
     }
 }
 
-void updateProjectiles(Game *game, Entity *projectiles) {
-    double delta = GetTime() - game->hotData->lastFrameTime;
-    Entity *current = projectiles->next;
+typedef struct ProjectilePass {
+    Projectiles *projectiles;
+    uint64_t hashes[JOBS_MAX_CHUNKS];
+    Coord step;
+    Coord bottom;
+} ProjectilePass;
+
+// A sum rather than a chained hash, so it doesn't depend on slot order or on
+// how the pool was split into chunks
+static inline uint64_t hashProjectiles(Projectiles *projectiles, int begin, int end, uint64_t salt) {
+    const Coord *x = projectiles->x;
+    const Coord *y = projectiles->y;
+    const uint8_t *alive = projectiles->alive;
+    uint64_t hash = 0;
+
+    for (int i = begin; i < end; ++i) {
+        hash += alive[i] ? mixHash(salt ^ hashFloats(fromCoord(x[i]), fromCoord(y[i]))) : 0;
+    }
+    return hash;
+}
 
-    while (current->type != LIST_SENTINEL) {
-        if (current->up) {
-            current->bounds.y -= game->coldData->projectileSpeed * delta;
-        } else {
-            current->bounds.y += game->coldData->projectileSpeed * delta;
-        }
+// Size and direction come in as constants from the kind table, so every
+// kind gets its own copy of the loop with a single culling test folded in
+static inline void integrateProjectiles(ProjectilePass *pass, int chunk, int begin, int end, float height, bool up, uint64_t salt) {
+    Coord *restrict y = pass->projectiles->y;
+    uint8_t *restrict alive = pass->projectiles->alive;
+    const Coord step = pass->step;
+    const Coord top = toCoord(-height);
+    const Coord bottom = pass->bottom;
+
+    for (int i = begin; i < end; ++i) {
+        y[i] += step;
+        alive[i] = alive[i] & (up ? y[i] >= top : y[i] <= bottom);
+    }
 
-        if ((current->bounds.y > game->screenHeight) || (current->bounds.y + current->bounds.height < 0.0f)) {
-            Entity *toKill = current;
-            current = current->prev;
-            killProjectile(toKill);
-        }
+    // Hashed while the chunk is still in cache, in its own loop so the one
+    // above keeps vectorizing
+    pass->hashes[chunk] = hashProjectiles(pass->projectiles, begin, end, salt);
+}
 
-        current = current->next;
+# define INTEGRATE_KERNEL(kind, Name, width, height, up, ...) \
+    void integrate##Name##Chunk(void *context, int chunk, int begin, int end) { \
+        integrateProjectiles((ProjectilePass *)context, chunk, begin, end, height, up, mixHash(kind + 1)); \
+    }
+PROJECTILE_KINDS(INTEGRATE_KERNEL)
+# undef INTEGRATE_KERNEL
+
+# define KERNEL_ENTRY(kind, Name, ...) integrate##Name##Chunk,
+static const JobFunction integrateKernels[PROJECTILE_KIND_COUNT] = {PROJECTILE_KINDS(KERNEL_ENTRY)};
+# undef KERNEL_ENTRY
+
+void updateProjectiles(Game *game, ProjectileKind kind) {
+    Projectiles *projectiles = game->projectiles[kind];
+    int count = projectiles->count;
+    Coord step = stepDistance(game, projectiles->velocity);
+    ProjectilePass pass = {.projectiles=projectiles, .step=step, .bottom=toCoord(game->screenHeight)};
+
+    int chunks = parallelFor(game->jobs, count, jobChunkSize(count, 1024), integrateKernels[kind], &pass);
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        game->hash.lanes[HASH_PROJECTILES] += pass.hashes[chunk];
     }
+    projectiles->travel = fromCoord(step);
+    compactProjectiles(projectiles);
 }
 
 void updateMenu(Game *game) {
     if (game->hotData->gameState == MENU) {
         if (game->hotData->input.up || game->hotData->input.down) {
-            PlaySound(game->sounds->menu);
+            playSoundEffect(&game->sounds->menu);
             if (game->hotData->menuButton == START)
                 game->hotData->menuButton = QUIT;
             else
@@ -390,7 +658,7 @@ void updateMenu(Game *game) {
         }
     } else if (game->hotData->gameState == WIN || game->hotData->gameState == LOSE) {
         if (game->hotData->input.up || game->hotData->input.down) {
-            PlaySound(game->sounds->menu);
+            playSoundEffect(&game->sounds->menu);
             if (game->hotData->menuButton == RESTART)
                 game->hotData->menuButton = QUIT;
             else
@@ -428,37 +696,140 @@ void updateGameState(Game *game) {
     }
 }
 
+// Adds the time since start to a phase and returns the new start
+double endPhase(float *phase, double start) {
+    double now = perfClock();
+    *phase += now - start;
+    return now;
+}
+
+void countPhase(Game *game, PerfPhase phase) {
+    if (game->perf != NULL) endPerfPhase(game->perf, phase);
+}
+
+# define END_POWERUP(kind, Name, width, height, up, texture, frame, effect) \
+    case kind: \
+        hotData->effect##Active = false; \
+        hotData->effect##Timer = NO_TIMER; \
+        break;
+
+void fireTimer(void *context, int event, int payload) {
+    Game *game = (Game *)context;
+    HotGameData *hotData = game->hotData;
+    Animation *animation = game->animation;
+
+    switch (event) {
+        case TIMER_POWERUP_ENDS:
+            switch (payload) {
+                POWERUP_KINDS(END_POWERUP)
+            }
+            break;
+        case TIMER_ENEMY_SHIP_ARRIVES:
+            hotData->enemyShipTimer = NO_TIMER;
+            hotData->enemyShipActive = true;
+            PlayMusicStream(game->sounds->enemyShip);
+            break;
+        case TIMER_ALIEN_FRAME:
+            animation->enemyCurrentFrame = (animation->enemyCurrentFrame + 1) % 4;
+            animation->aliensFrame.x = animation->aliensFrame.x + animation->aliensFrame.width*animation->enemyCurrentFrame;
+            scheduleTimer(game->timers, secondsToTicks(game->coldData->alienTimePerFrame), TIMER_ALIEN_FRAME, 0);
+            break;
+        case TIMER_SHIP_RELOADED:
+            hotData->shipLoaded = true;
+            break;
+        case TIMER_ENEMY_SHIP_RELOADED:
+            hotData->enemyShipLoaded = true;
+            break;
+    }
+}
+# undef END_POWERUP
+
+// One fixed slice of simulated time
+void stepGame(Game *game) {
+    TelemetryRecord *stats = &game->frameStats;
+    game->stepDelta = STEP_DELTA;
+    game->hotData->simTicks++;
+    advanceTimerWheel(game->timers, game->hotData->simTicks, fireTimer, game);
+
+    if (game->hordeLastAlive->bounds.y + game->horde->next->bounds.height >= game->ship->bounds.y) {
+        game->hotData->gameState = LOSE;
+        game->hotData->menuButton = RESTART;
+        StopMusicStream(game->sounds->background);
+        playSoundEffect(&game->sounds->lose);
+        explode(game, game->ship->bounds, 400, ORANGE);
+        game->hotData->shipActive = false;
+        stats->events |= EVENT_PLAYER_KILLED;
+    }
+
+    if (game->perf != NULL) markPerfHarness(game->perf);
+    double phase = perfClock();
+    detectCollisions(game);
+    phase = endPhase(&stats->collisionTime, phase);
+    countPhase(game, PERF_COLLISIONS);
+    updateShip(game);
+    phase = endPhase(&stats->shipTime, phase);
+    countPhase(game, PERF_SHIP);
+    updateHorde(game);
+    phase = endPhase(&stats->hordeTime, phase);
+    countPhase(game, PERF_HORDE);
+    updateEnemyShip(game);
+    phase = endPhase(&stats->enemyShipTime, phase);
+    countPhase(game, PERF_ENEMY_SHIP);
+    game->hash.lanes[HASH_PROJECTILES] = 0;
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        updateProjectiles(game, kind);
+    }
+    endPhase(&stats->projectileTime, phase);
+    countPhase(game, PERF_PROJECTILES);
+}
+
+// The frame's wall time is scaled and paid off in steps of exactly
+// STEP_DELTA, the remainder carries over to the next frame. Every step is
+// the same length however the frames fall, so a seeded game plays out the
+// same at any frame rate or time scale.
+int planSteps(Game *game, float elapsed) {
+    game->stepDebt += elapsed;
+    int steps = (int)(game->stepDebt/STEP_DELTA);
+    if (steps > MAX_STEPS_PER_FRAME) {
+        // Behind by more than a frame can catch up on, the game slows down
+        // rather than falling further behind
+        steps = MAX_STEPS_PER_FRAME;
+        game->stepDebt = 0.0f;
+    } else {
+        game->stepDebt -= steps*STEP_DELTA;
+    }
+    return steps;
+}
+
 void updateGame(Game *game) {
+    float elapsed = game->frameTime*game->coldData->timeScale;
     updateGameState(game);
     UpdateMusicStream(game->sounds->background);
 
     if (game->hotData->gameState == PLAYING) {
-        if (game->hordeLastAlive->bounds.y + game->horde->next->bounds.height >= game->ship->bounds.y) {
-            game->hotData->gameState = LOSE;
-            game->hotData->menuButton = RESTART;
-            StopMusicStream(game->sounds->background);
-            PlaySound(game->sounds->lose);
-            game->hotData->shipActive = false;
+        // Only the first step sees the frame's presses, or one press would
+        // act once per step and how the frames fell would decide the game
+        Input input = game->hotData->input;
+        int steps = planSteps(game, elapsed);
+        for (int step = 0; step < steps && game->hotData->gameState == PLAYING; ++step) {
+            stepGame(game);
+            game->hotData->input = heldButtons(input);
         }
-
-        detectCollisions(game);
-        updateShip(game);
-        updateHorde(game);
-        updateEnemyShip(game);
-        updateProjectiles(game, game->bullets);
-        updateProjectiles(game, game->powerups);
+        game->hotData->input = input;
     } else if (game->hotData->gameState != CLOSE)
         updateMenu(game);
-    
-    game->hotData->lastFrameTime = GetTime();
+
+    double phase = perfClock();
+    updateParticles(game->particles, elapsed);
+    endPhase(&game->frameStats.particleTime, phase);
 }
 
-bool detectCollision(Entity *entity, Entity *otherEntity) {
+bool detectCollision(Rectangle bounds, Rectangle otherBounds) {
     if (
-        entity->bounds.x <= otherEntity->bounds.x + otherEntity->bounds.width &&
-        entity->bounds.x + entity->bounds.width >= otherEntity->bounds.x &&
-        entity->bounds.y <= otherEntity->bounds.y + otherEntity->bounds.width &&
-        entity->bounds.y + entity->bounds.height >= otherEntity->bounds.y
+        bounds.x <= otherBounds.x + otherBounds.width &&
+        bounds.x + bounds.width >= otherBounds.x &&
+        bounds.y <= otherBounds.y + otherBounds.height &&
+        bounds.y + bounds.height >= otherBounds.y
     ) {
         return true;
     }
@@ -466,105 +837,253 @@ bool detectCollision(Entity *entity, Entity *otherEntity) {
     return false;
 }
 
-void detectCollisions(Game *game) {
-    Entity *currentBullet = game->bullets->next;
-    bool hit;
-    int dropCheck;
-    while (currentBullet->type != LIST_SENTINEL) {
-        hit = false;
-        if (currentBullet->up) {
-            Entity *currentEnemy = game->horde->next;
-            while (currentEnemy->type != LIST_SENTINEL) {
-                if (detectCollision(currentBullet, currentEnemy)) {
-                    hit = true;
-                    dropCheck = rand() % 100;
-                    break;
-                }
-                currentEnemy = currentEnemy->next;
+// The rectangles reject almost every pair, the masks then only settle the
+// ones that touch, which rules out the transparent corners of the sprites.
+// A projectile is tested along the whole path it took over the last step,
+// the masks a projectile length apart over the stretch level with the other
+// sprite, so no step is long enough to carry it through. The other sprite is
+// taken where it is now, it moves far less in a step than a projectile does.
+bool detectSweptCollision(const SpriteMask *mask, Rectangle path, float height, const SpriteMask *otherMask, Rectangle otherBounds) {
+    if (!detectCollision(path, otherBounds)) return false;
+
+    float first = fmaxf(path.y, otherBounds.y - height);
+    float last = fminf(path.y + path.height - height, otherBounds.y + otherBounds.height);
+    Rectangle bounds = {.height=height, .width=path.width, .x=path.x, .y=first};
+    for (;;) {
+        if (masksOverlap(mask, bounds, otherMask, otherBounds)) return true;
+        if (bounds.y >= last) return false;
+        bounds.y = fminf(bounds.y + height, last);
+    }
+}
+
+typedef struct CollisionPass {
+    Projectiles *bullets;
+    Entity *aliens;
+    int *hits;
+    const SpriteMask *bulletMask;
+    const SpriteMask *alienMasks[ALIEN_KIND_COUNT];
+    uint32_t tests[JOBS_MAX_CHUNKS];
+} CollisionPass;
+
+int findAlienHit(CollisionPass *pass, Rectangle path, uint32_t *tests) {
+    Entity *aliens = pass->aliens;
+    float height = pass->bullets->height;
+    for (int i = 0; i < HORDE_SIZE; ++i) {
+        if (!aliens[i].alive) continue;
+        ++*tests;
+        if (detectSweptCollision(pass->bulletMask, path, height, pass->alienMasks[aliens[i].alienType], aliens[i].bounds)) return i;
+    }
+
+    return -1;
+}
+
+void findHitsChunk(void *context, int chunk, int begin, int end) {
+    CollisionPass *pass = (CollisionPass *)context;
+    uint32_t tests = 0;
+
+    for (int i = begin; i < end; ++i) {
+        pass->hits[i] = findAlienHit(pass, sweptProjectileBounds(pass->bullets, i), &tests);
+    }
+    pass->tests[chunk] = tests;
+}
+
+// Player and enemy bullets are both sorted by x, so one sweep over the
+// player bullets only ever looks at the enemy bullets within its column.
+// Two bullets meet if the paths they took over the last step overlap.
+void interceptBullets(Game *game) {
+    Projectiles *up = game->projectiles[PLAYER_BULLET];
+    Projectiles *down = game->projectiles[ENEMY_BULLET];
+    const int *upOrder = sortProjectilesByX(up);
+    const int *downOrder = sortProjectilesByX(down);
+    int first = 0;
+
+    for (int a = 0; a < up->count && first < down->count; ++a) {
+        int i = upOrder[a];
+        Coord left = toCoord(fromCoord(up->x[i]) - down->width);
+        Coord right = toCoord(fromCoord(up->x[i]) + up->width);
+
+        while (first < down->count && down->x[downOrder[first]] < left) ++first;
+        for (int b = first; b < down->count && down->x[downOrder[b]] <= right; ++b) {
+            int j = downOrder[b];
+            if (!down->alive[j]) continue;
+            Rectangle upPath = sweptProjectileBounds(up, i);
+            Rectangle downPath = sweptProjectileBounds(down, j);
+            if (upPath.y <= downPath.y + downPath.height && upPath.y + upPath.height >= downPath.y) {
+                killProjectile(up, i);
+                killProjectile(down, j);
+                explode(game, projectileBounds(down, j), 30, YELLOW);
+                game->frameStats.events |= EVENT_INTERCEPTED;
+                break;
             }
+        }
+    }
+}
 
-            if (hit) {
-                if (currentEnemy == game->hordeLastAlive) {
-                    // Will be LIST_SENTINEL when the player win
-                    game->hordeLastAlive = currentEnemy->prev;
-                    if (game->hordeLastAlive->type == LIST_SENTINEL) {
+// Returns true when the hit ended the game or the wave
+bool collidePlayerBullets(Game *game) {
+    Projectiles *bullets = game->projectiles[PLAYER_BULLET];
+    int count = bullets->count;
+    Masks *masks = game->masks;
+    Animation *animation = game->animation;
+    CollisionPass pass = {
+        .bullets=bullets,
+        .aliens=&game->horde[1],
+        .hits=game->bulletHits,
+        .bulletMask=sheetFrame(&masks->projectiles[PLAYER_BULLET], animation->bulletFrame),
+    };
+    for (int kind = 0; kind < ALIEN_KIND_COUNT; ++kind) {
+        pass.alienMasks[kind] = sheetFrame(&masks->aliens[kind], animation->aliensFrame);
+    }
+    const SpriteMask *enemyShipMask = sheetFrame(&masks->enemyShip, animation->enemyShipFrame);
+    int dropCheck;
+
+    // The search is read-only and runs in parallel, hits are then applied in
+    // pool order so the outcome doesn't depend on the thread count
+    int chunks = parallelFor(game->jobs, count, jobChunkSize(count, 32), findHitsChunk, &pass);
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        game->frameStats.collisionTests += pass.tests[chunk];
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (!bullets->alive[i]) continue;
+
+        // Bunkers take the path too, they already scan rows in the order the
+        // bullet meets them
+        Rectangle currentBullet = sweptProjectileBounds(bullets, i);
+        if (hitBunkers(game->bunkers, currentBullet, true)) {
+            killProjectile(bullets, i);
+            continue;
+        }
+
+        int hit = pass.hits[i];
+        // An earlier bullet may have taken this alien out in the same frame
+        if (hit >= 0 && !pass.aliens[hit].alive) hit = findAlienHit(&pass, currentBullet, &game->frameStats.collisionTests);
+
+        if (hit >= 0) {
+            Entity *currentEnemy = &pass.aliens[hit];
+            dropCheck = randomBelow(&game->hotData->random, 100);
+            game->hash.aliveSet ^= hashAlienSlot(hit);
+            if (currentEnemy == game->hordeLastAlive) {
+                // Will be LIST_SENTINEL when the player win
+                game->hordeLastAlive = currentEnemy->prev;
+                if (game->hordeLastAlive->type == LIST_SENTINEL) {
+                    game->frameStats.kills++;
+                    game->frameStats.events |= EVENT_ALIEN_KILLED | EVENT_WAVE_CLEARED;
+                    killProjectile(bullets, i);
+                    explode(game, currentEnemy->bounds, 150, WHITE);
+                    killEnemy(currentEnemy);
+                    playSoundEffect(&game->sounds->enemyExplosion);
+                    if (game->hotData->wave + 1 < game->level->waveCount) {
+                        // Only a short chime between waves, the fanfare is for the win
+                        playSoundEffect(&game->sounds->powerup);
+                        startWave(game, game->hotData->wave + 1);
+                    } else {
+                        playSoundEffect(&game->sounds->victory);
                         game->hotData->gameState = WIN;
                         game->hotData->menuButton = RESTART;
-                        killBullet(currentBullet);
-                        killEnemy(currentEnemy);
-                        PlaySound(game->sounds->enemyExplosion);
-                        PlaySound(game->sounds->victory);
-                        return;
-                    }
-                }
-                if (dropCheck < 100) {
-                    generatePowerup(game->powerups, currentEnemy->bounds.x + currentEnemy->bounds.width/2.0f, currentEnemy->bounds.y + currentEnemy->bounds.height);
-                }
-                Entity *temp = currentBullet->prev;
-                killBullet(currentBullet);
-                killEnemy(currentEnemy);
-                currentBullet = temp;
-                PlaySound(game->sounds->enemyExplosion);
-            } else {
-                if (game->hotData->enemyShipActive && detectCollision(currentBullet, game->enemyShip)) {
-                    dropCheck = rand() % 100;
-                    if (dropCheck < 15) {
-                        generatePowerup(game->powerups, game->enemyShip->bounds.x + game->enemyShip->bounds.width/2.0f, game->enemyShip->bounds.y + game->enemyShip->bounds.height);
                     }
-                    Entity *temp = currentBullet->prev;
-                    game->hotData->enemyShipActive = false;
-                    game->hotData->enemyShipDefeated = true;
-                    killBullet(currentBullet);
-                    currentBullet = temp;
-                    PlaySound(game->sounds->shipExplosion);
+                    return true;
                 }
             }
-            currentBullet = currentBullet->next;
-        } else {
-            if (detectCollision(game->ship, currentBullet)) {
-                game->hotData->gameState = LOSE;
-                game->hotData->menuButton = RESTART;
-                StopMusicStream(game->sounds->background);
-                killBullet(currentBullet);
-                PlaySound(game->sounds->shipExplosion);
-                PlaySound(game->sounds->lose);
-                game->hotData->shipActive = false;
-                return;
-            } else {
-                currentBullet = currentBullet->next;
+            if (dropCheck < 100) {
+                dropPowerup(game, currentEnemy->bounds.x + currentEnemy->bounds.width/2.0f, currentEnemy->bounds.y + currentEnemy->bounds.height);
             }
+            killProjectile(bullets, i);
+            explode(game, currentEnemy->bounds, 150, WHITE);
+            killEnemy(currentEnemy);
+            playSoundEffect(&game->sounds->enemyExplosion);
+            game->frameStats.kills++;
+            game->frameStats.events |= EVENT_ALIEN_KILLED;
+        } else if (game->hotData->enemyShipActive && detectSweptCollision(pass.bulletMask, currentBullet, bullets->height, enemyShipMask, game->enemyShip->bounds)) {
+            dropCheck = randomBelow(&game->hotData->random, 100);
+            if (dropCheck < 15) {
+                dropPowerup(game, game->enemyShip->bounds.x + game->enemyShip->bounds.width/2.0f, game->enemyShip->bounds.y + game->enemyShip->bounds.height);
+            }
+            game->hotData->enemyShipActive = false;
+            game->hotData->enemyShipDefeated = true;
+            killProjectile(bullets, i);
+            explode(game, game->enemyShip->bounds, 300, RED);
+            playSoundEffect(&game->sounds->shipExplosion);
+            game->frameStats.events |= EVENT_ENEMY_SHIP_KILLED;
         }
     }
 
-    Entity *currentPowerup = game->powerups->next;
-    while (currentPowerup->type != LIST_SENTINEL) {
-        if (detectCollision(game->ship, currentPowerup)) {
-            if (currentPowerup->type == FAST_SHOT) {
-                game->hotData->fastShotActive = true;
-                game->hotData->fastShotRemainingTime = game->coldData->powerupDuration;
-            } else {
-                game->hotData->fastMoveActive = true;
-                game->hotData->fastMoveRemainingTime = game->coldData->powerupDuration;
-            }
+    return false;
+}
+
+// Returns true when the hit ended the game
+bool collideEnemyBullets(Game *game) {
+    Projectiles *bullets = game->projectiles[ENEMY_BULLET];
+    const SpriteMask *shipMask = sheetFrame(&game->masks->ship, game->animation->shipFrame);
+    const SpriteMask *bulletMask = sheetFrame(&game->masks->projectiles[ENEMY_BULLET], game->animation->bulletFrame);
+
+    for (int i = 0; i < bullets->count; ++i) {
+        if (!bullets->alive[i]) continue;
+
+        Rectangle path = sweptProjectileBounds(bullets, i);
+        if (hitBunkers(game->bunkers, path, false)) {
+            killProjectile(bullets, i);
+        } else if (detectSweptCollision(bulletMask, path, bullets->height, shipMask, game->ship->bounds)) {
+            game->hotData->gameState = LOSE;
+            game->hotData->menuButton = RESTART;
+            StopMusicStream(game->sounds->background);
+            killProjectile(bullets, i);
+            explode(game, game->ship->bounds, 400, ORANGE);
+            playSoundEffect(&game->sounds->shipExplosion);
+            playSoundEffect(&game->sounds->lose);
+            game->hotData->shipActive = false;
+            game->frameStats.events |= EVENT_PLAYER_KILLED;
+            return true;
+        }
+    }
 
-            Entity *temp = currentPowerup;
-            currentPowerup = currentPowerup->prev;
-            killPowerup(temp);
-            PlaySound(game->sounds->powerup);
+    return false;
+}
+
+static inline void collidePowerups(Game *game, Projectiles *powerups, ProjectileKind kind, const SpriteMask *mask, bool *active, TimerHandle *timer) {
+    const SpriteMask *shipMask = sheetFrame(&game->masks->ship, game->animation->shipFrame);
+
+    for (int i = 0; i < powerups->count; ++i) {
+        if (powerups->alive[i] && detectSweptCollision(mask, sweptProjectileBounds(powerups, i), powerups->height, shipMask, game->ship->bounds)) {
+            *active = true;
+            restartTimer(game, timer, game->coldData->powerupDuration, TIMER_POWERUP_ENDS, kind);
+            killProjectile(powerups, i);
+            playSoundEffect(&game->sounds->powerup);
+            game->frameStats.events |= EVENT_POWERUP_TAKEN;
         }
-        currentPowerup = currentPowerup->next;
     }
 }
 
+# define COLLIDE_KERNEL(kind, Name, width, height, up, texture, frame, effect) \
+    void collide##Name(Game *game) { \
+        collidePowerups( \
+            game, \
+            game->projectiles[kind], \
+            kind, \
+            sheetFrame(&game->masks->projectiles[kind], game->animation->frame), \
+            &game->hotData->effect##Active, \
+            &game->hotData->effect##Timer \
+        ); \
+    }
+POWERUP_KINDS(COLLIDE_KERNEL)
+# undef COLLIDE_KERNEL
+
+void detectCollisions(Game *game) {
+    if (game->coldData->bulletInterception) interceptBullets(game);
+    if (collidePlayerBullets(game) || collideEnemyBullets(game)) return;
+
+# define COLLIDE_KIND(kind, Name, ...) collide##Name(game);
+    POWERUP_KINDS(COLLIDE_KIND)
+# undef COLLIDE_KIND
+}
+
 void drawShip(Game *game) {
     if (game->hotData->shipActive) {
-        Vector2 origin = {0.0f, 0.0f};
-        DrawTexturePro(
+        game->renderer->texture(
+            game->renderer,
             game->textures->ship,
             game->animation->shipFrame,
             game->ship->bounds,
-            origin,
-            0.0f,
             WHITE
         );
     }
@@ -572,101 +1091,74 @@ void drawShip(Game *game) {
 
 void drawEnemyShip(Game *game) {
     if (!game->hotData->enemyShipDefeated && game->hotData->enemyShipActive) {
-        Vector2 origin = {0.0f, 0.0f};
-        DrawTexturePro(
+        game->renderer->texture(
+            game->renderer,
             game->textures->enemyShip,
             game->animation->enemyShipFrame,
             game->enemyShip->bounds,
-            origin,
-            0.0f,
             WHITE
         );
     }
 }
 
-void drawAlien(Game *game, Entity *alien) {
-    Vector2 origin = {0.0f, 0.0f};
-    Texture2D currentTex;
-    if (alien->alienType == TYPE1) currentTex = game->textures->alienFaster;
-    else if (alien->alienType == TYPE2) currentTex = game->textures->alienFast;
-    else currentTex = game->textures->alienSlow;
-
-    DrawTexturePro(
-        currentTex,
-        game->animation->aliensFrame,
-        alien->bounds,
-        origin,
-        0.0f,
-        WHITE
-    );
-}
-
-void drawHorde(Game *game) {
-    Entity *currentAlien = game->horde->next;
-    while (currentAlien->type != LIST_SENTINEL) {
-        drawAlien(game, currentAlien);
-        currentAlien = currentAlien->next;
-    }
-}
-
-void drawBullet(Game *game, Entity *bullet) {
-    Vector2 origin = {0.0f, 0.0f};
-    DrawTexturePro(
-        game->textures->bullet,
-        game->animation->bulletFrame,
-        bullet->bounds,
-        origin,
-        0.0f,
-        WHITE
-    );
+// Each kind is drawn in one run with its texture fixed, so raylib can keep
+// batching instead of flushing on every texture switch
+static inline void drawAliens(Game *game, AlienTexture kind, Texture2D texture) {
+    RenderBackend *renderer = game->renderer;
+    Entity *aliens = &game->horde[1];
+
+    for (int i = game->alienKindStart[kind]; i < game->alienKindStart[kind + 1]; ++i) {
+        if (!aliens[i].alive) continue;
+        renderer->texture(
+            renderer,
+            texture,
+            game->animation->aliensFrame,
+            aliens[i].bounds,
+            WHITE
+        );
+    }
 }
 
-void drawBullets(Game *game) {
-    Entity *currentBullet = game->bullets->next;
-    while (currentBullet->type != LIST_SENTINEL) {
-        drawBullet(game, currentBullet);
-        currentBullet = currentBullet->next;
+# define DRAW_ALIENS_KERNEL(kind, Name, texture) \
+    void draw##Name##Aliens(Game *game) { \
+        drawAliens(game, kind, game->textures->texture); \
     }
-}
+ALIEN_KINDS(DRAW_ALIENS_KERNEL)
+# undef DRAW_ALIENS_KERNEL
 
-void drawPowerup(Game *game, Entity *powerup) {
-    Vector2 origin = {0.0f, 0.0f};
-    Texture2D currentTex;
-    if (powerup->type == FAST_SHOT) currentTex = game->textures->shotPowerup;
-    else currentTex = game->textures->movePowerup;
-    DrawTexturePro(
-        currentTex,
-        game->animation->powerupFrame,
-        powerup->bounds,
-        origin,
-        0.0f,
-        WHITE
-    );
+void drawHorde(Game *game) {
+# define DRAW_ALIEN_KIND(kind, Name, ...) draw##Name##Aliens(game);
+    ALIEN_KINDS(DRAW_ALIEN_KIND)
+# undef DRAW_ALIEN_KIND
 }
 
-void drawPowerups(Game *game) {
-    Entity *currentPowerup = game->powerups->next;
-    while (currentPowerup->type != LIST_SENTINEL) {
-        drawPowerup(game, currentPowerup);
-        currentPowerup = currentPowerup->next;
+static inline void drawProjectiles(RenderBackend *renderer, Projectiles *projectiles, Texture2D texture, Rectangle frame) {
+    for (int i = 0; i < projectiles->count; ++i) {
+        renderer->texture(
+            renderer,
+            texture,
+            frame,
+            projectileBounds(projectiles, i),
+            WHITE
+        );
     }
 }
 
-void drawMenuBanner(Rectangle *banner) {
-    Vector2 origin = {0.0f, 0.0f};
+# define DRAW_PROJECTILES_KERNEL(kind, Name, width, height, up, texture, frame, effect) \
+    void draw##Name(Game *game) { \
+        drawProjectiles(game->renderer, game->projectiles[kind], game->textures->texture, game->animation->frame); \
+    }
+PROJECTILE_KINDS(DRAW_PROJECTILES_KERNEL)
+# undef DRAW_PROJECTILES_KERNEL
 
-    DrawRectanglePro(
-        *banner,
-        origin,
-        0.0f,
-        WHITE
-    );
+void drawMenuBanner(Game *game, Rectangle *banner) {
+    game->renderer->rectangle(game->renderer, *banner, WHITE);
 }
 
 void drawMenuButtons(Game *game, Rectangle *banner) {
+    RenderBackend *renderer = game->renderer;
     float sizeQuit = 80.0f, sizeStart = 80.0f, sizeRestart = 80.0f;
     float spacing = 5.0f;
-    Font defaultFont = GetFontDefault();
     float topX = banner->x + banner->width/2.0f;
     float topY = banner->y + 50.0f;
     float bottomX = topX;
@@ -684,24 +1176,24 @@ void drawMenuButtons(Game *game, Rectangle *banner) {
     switch (game->hotData->gameState) {
         case MENU:
         {
-            Vector2 dimensionsStart = MeasureTextEx(defaultFont, "START", sizeStart, spacing);
-            Vector2 dimensionsQuit = MeasureTextEx(defaultFont, "QUIT", sizeQuit, spacing);
+            Vector2 dimensionsStart = renderer->measureText(renderer, "START", sizeStart, spacing);
+            Vector2 dimensionsQuit = renderer->measureText(renderer, "QUIT", sizeQuit, spacing);
             topX -= dimensionsStart.x/2.0f;
             bottomX -= dimensionsQuit.x/2.0f;
             bottomY -= dimensionsQuit.y;
-            DrawText("START", topX, topY, sizeStart, BLACK);
-            DrawText("QUIT", bottomX, bottomY, sizeQuit, BLACK);
+            renderer->text(renderer, "START", topX, topY, sizeStart, BLACK);
+            renderer->text(renderer, "QUIT", bottomX, bottomY, sizeQuit, BLACK);
         } break;
         case WIN:
         case LOSE:
         {
-            Vector2 dimensionsRestart = MeasureTextEx(defaultFont, "RESTART", sizeRestart, spacing);
-            Vector2 dimensionsQuit = MeasureTextEx(defaultFont, "QUIT", sizeQuit, spacing);
+            Vector2 dimensionsRestart = renderer->measureText(renderer, "RESTART", sizeRestart, spacing);
+            Vector2 dimensionsQuit = renderer->measureText(renderer, "QUIT", sizeQuit, spacing);
             topX -= dimensionsRestart.x/2.0f;
             bottomX -= dimensionsQuit.x/2.0f;
             bottomY -= dimensionsQuit.y;
-            DrawText("RESTART", topX, topY, sizeRestart, BLACK);
-            DrawText("QUIT", bottomX, bottomY, sizeQuit, BLACK);
+            renderer->text(renderer, "RESTART", topX, topY, sizeRestart, BLACK);
+            renderer->text(renderer, "QUIT", bottomX, bottomY, sizeQuit, BLACK);
         } break;
         default: break;
     }
@@ -714,7 +1206,7 @@ void drawMenu(Game *game) {
     const float y = (game->screenHeight - height)/2.0f;
     Rectangle banner = {.height=height, .width=width, .x=x, .y=y};
 
-    drawMenuBanner(&banner);
+    drawMenuBanner(game, &banner);
     drawMenuButtons(game, &banner);
 }
 
@@ -726,18 +1218,23 @@ void drawEndStatus(Game *game) {
         strcpy(message, "DEFEATED");
     }
 
-    float posX = (game->screenWidth - MeasureText(message, 200))/2.0f;
-    DrawText(message, posX, 150.0f, 200, RAYWHITE);
+    // MeasureText spaces the default font by a tenth of its size
+    float width = game->renderer->measureText(game->renderer, message, 200.0f, 20.0f).x;
+    float posX = (game->screenWidth - (int)width)/2.0f;
+    game->renderer->text(game->renderer, message, posX, 150.0f, 200, RAYWHITE);
 }
 
 void drawGame(Game *game) {
-    ClearBackground(BLACK);
-    DrawFPS(10, 10);
+    game->renderer->clear(game->renderer, BLACK);
+    game->renderer->fps(game->renderer, 10, 10);
     drawShip(game);
     drawEnemyShip(game);
+    drawBunkers(game->bunkers, game->renderer);
     drawHorde(game);
-    drawBullets(game);
-    drawPowerups(game);
+# define DRAW_PROJECTILE_KIND(kind, Name, ...) draw##Name(game);
+    PROJECTILE_KINDS(DRAW_PROJECTILE_KIND)
+# undef DRAW_PROJECTILE_KIND
+    drawParticles(game->particles, game->renderer);
 
     if (game->hotData->gameState != PLAYING) {
         drawMenu(game);
@@ -747,26 +1244,695 @@ void drawGame(Game *game) {
     }
 }
 
-void mainLoop() {
+uint16_t quantizePosition(float value) {
+    float quantized = (value + 64.0f)*4.0f + 0.5f;
+    if (quantized < 0.0f) return 0;
+    if (quantized > 65535.0f) return 65535;
+    return (uint16_t)quantized;
+}
+
+float dequantizePosition(uint16_t value) {
+    return (float)value/4.0f - 64.0f;
+}
+
+uint16_t quantizePixel(float value, float offset) {
+    float quantized = value + offset + 0.5f;
+    if (quantized < 0.0f) return 0;
+    if (quantized > 2047.0f) return 2047;
+    return (uint16_t)quantized;
+}
+
+uint16_t quantizeTime(double value) {
+    double quantized = value*100.0 + 0.5;
+    if (quantized < 0.0) return 0;
+    if (quantized > 1023.0) return 1023;
+    return (uint16_t)quantized;
+}
+
+// Returns how many did not fit
+int captureProjectiles(Snapshot *snapshot, Projectiles *projectiles, ProjectileKind kind) {
+    int i = 0;
+    for (; i < projectiles->count && snapshot->projectileCount < NET_MAX_PROJECTILES; ++i) {
+        int index = snapshot->projectileCount++;
+        snapshot->projectileKind[index] = kind;
+        snapshot->projectileX[index] = quantizePixel(fromCoord(projectiles->x[i]), 0.0f);
+        snapshot->projectileY[index] = quantizePixel(fromCoord(projectiles->y[i]), 64.0f);
+    }
+    return projectiles->count - i;
+}
+
+// Returns how many projectiles were left out of it
+int captureSnapshot(Game *game, Snapshot *snapshot) {
+    HotGameData *hotData = game->hotData;
+    Entity *aliens = &game->horde[1];
+
+    // The whole formation moves as one block, so its first slot places it
+    snapshot->aliveBits = 0;
+    for (int i = 0; i < HORDE_SIZE; ++i) {
+        snapshot->aliveBits |= (uint64_t)aliens[i].alive << i;
+    }
+    snapshot->hordeX = quantizePosition(aliens[0].bounds.x);
+    snapshot->hordeY = quantizePosition(aliens[0].bounds.y);
+    snapshot->shipX = quantizePosition(game->ship->bounds.x);
+    snapshot->enemyShipX = quantizePosition(game->enemyShip->bounds.x);
+    snapshot->hordeSpeed = (int16_t)(hotData->hordeSpeed*8.0f);
+    snapshot->fastShotTime = hotData->fastShotActive ? quantizeTime(timerSeconds(game, hotData->fastShotTimer)) : 0;
+    snapshot->fastMoveTime = hotData->fastMoveActive ? quantizeTime(timerSeconds(game, hotData->fastMoveTimer)) : 0;
+    snapshot->enemyShipAlarm = quantizeTime(timerSeconds(game, hotData->enemyShipTimer));
+    snapshot->state = hotData->gameState | hotData->menuButton << 3;
+    snapshot->wave = hotData->wave;
+    snapshot->flags = hotData->fastShotActive |
+        hotData->fastMoveActive << 1 |
+        hotData->enemyShipGoingLeft << 2 |
+        hotData->enemyShipDefeated << 3 |
+        hotData->enemyShipActive << 4 |
+        hotData->shipActive << 5;
+
+    int dropped = 0;
+    snapshot->projectileCount = 0;
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        dropped += captureProjectiles(snapshot, game->projectiles[kind], kind);
+    }
+    return dropped;
+}
+
+void applySnapshot(Game *game, const Snapshot *snapshot) {
+    HotGameData *hotData = game->hotData;
+    Entity *aliens = &game->horde[1];
+
+    if (snapshot->wave != hotData->wave && snapshot->wave < game->level->waveCount) {
+        hotData->wave = snapshot->wave;
+        resetHorde(game->horde, currentWave(game), game->alienKindStart);
+    }
+    float shiftX = dequantizePosition(snapshot->hordeX) - aliens[0].bounds.x;
+    float shiftY = dequantizePosition(snapshot->hordeY) - aliens[0].bounds.y;
+
+    for (int i = 0; i < HORDE_SIZE; ++i) {
+        bool alive = (snapshot->aliveBits >> i) & 1u;
+        aliens[i].bounds.x += shiftX;
+        aliens[i].bounds.y += shiftY;
+        if (aliens[i].alive && !alive) explode(game, aliens[i].bounds, 150, WHITE);
+        aliens[i].alive = alive;
+    }
+    game->hordeLastAlive = relinkHorde(game->horde);
+
+    game->ship->bounds.x = dequantizePosition(snapshot->shipX);
+    game->enemyShip->bounds.x = dequantizePosition(snapshot->enemyShipX);
+    hotData->hordeSpeed = (float)snapshot->hordeSpeed/8.0f;
+    // The spectator's wheel never advances, the timers only carry what the
+    // host had left on them
+    restartTimer(game, &hotData->fastShotTimer, snapshot->fastShotTime/100.0, TIMER_POWERUP_ENDS, SHOT_POWERUP);
+    restartTimer(game, &hotData->fastMoveTimer, snapshot->fastMoveTime/100.0, TIMER_POWERUP_ENDS, MOVE_POWERUP);
+    restartTimer(game, &hotData->enemyShipTimer, snapshot->enemyShipAlarm/100.0, TIMER_ENEMY_SHIP_ARRIVES, 0);
+    hotData->gameState = (GameState)(snapshot->state & 7);
+    hotData->menuButton = (MenuButton)(snapshot->state >> 3);
+    hotData->fastShotActive = snapshot->flags & 1;
+    hotData->fastMoveActive = (snapshot->flags >> 1) & 1;
+    hotData->enemyShipGoingLeft = (snapshot->flags >> 2) & 1;
+    hotData->enemyShipDefeated = (snapshot->flags >> 3) & 1;
+    hotData->enemyShipActive = (snapshot->flags >> 4) & 1;
+    hotData->shipActive = (snapshot->flags >> 5) & 1;
+
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        clearProjectiles(game->projectiles[kind]);
+    }
+    for (int i = 0; i < snapshot->projectileCount; ++i) {
+        Projectiles *projectiles = game->projectiles[snapshot->projectileKind[i]];
+        float x = (float)snapshot->projectileX[i] + projectiles->width/2.0f;
+        float y = (float)snapshot->projectileY[i] - 64.0f;
+        generateProjectile(projectiles, x, y);
+    }
+}
+
+// The spectator never simulates, it only mirrors what the host sends
+void updateSpectator(Game *game) {
+    if (game->hotData->input.pause) {
+        game->hotData->gameState = CLOSE;
+        return;
+    }
+
+    const Snapshot *snapshot = receiveSnapshot(game->net, game->clock);
+    if (snapshot != NULL) applySnapshot(game, snapshot);
+
+    updateParticles(game->particles, game->frameTime);
+}
+
+// Once per frame, however many steps it ran
+void publishSnapshot(Game *game) {
+    int dropped = captureSnapshot(game, nextSnapshot(game->net));
+    if (dropped > 0 && game->net->truncatedSnapshots++ == 0) {
+        TraceLog(LOG_WARNING, "NET: %d projectiles did not fit in a snapshot, spectators won't see them", dropped);
+    }
+    sendSnapshot(game->net, game->clock);
+}
+
+// Only what the simulation decides goes in, the frame clock is wall time and
+// would differ between any two runs
+uint64_t hashHotData(Game *game) {
+    HotGameData *hotData = game->hotData;
+    uint64_t hash = mixHash(hotData->simTicks);
+    hash = hashCombine(hash, game->timers->hash ^ game->timers->now);
+    hash = hashCombine(hash, hashFloats(hotData->hordeSpeed, game->ship->bounds.x));
+    hash = hashCombine(hash, hashFloats(game->enemyShip->bounds.x, game->enemyShip->bounds.y));
+    hash = hashCombine(hash, (uint64_t)hotData->wave << 32 | hotData->gameState << 8 | hotData->menuButton);
+    hash = hashCombine(hash,
+        hotData->fastShotActive |
+        hotData->fastMoveActive << 1 |
+        hotData->enemyShipGoingLeft << 2 |
+        hotData->enemyShipDefeated << 3 |
+        hotData->enemyShipActive << 4 |
+        hotData->shipActive << 5 |
+        hotData->shipLoaded << 6 |
+        hotData->enemyShipLoaded << 7);
+    return hash;
+}
+
+// Alive aliens, projectiles and bunkers are kept up to date as they change,
+// the rest is a handful of words and is folded in once per tick
+void finishStateHash(Game *game) {
+    StateHash *hash = &game->hash;
+    Rectangle origin = game->horde[1].bounds;
+
+    hash->lanes[HASH_HOT] = hashHotData(game);
+    hash->lanes[HASH_FORMATION] = hashCombine(hash->aliveSet, hashFloats(origin.x, origin.y));
+    hash->lanes[HASH_BUNKERS] = game->bunkers->hash;
+    hash->lanes[HASH_RANDOM] = mixHash(game->hotData->random.state);
+}
+
+// From scratch, for state that was just loaded wholesale
+void rehashState(Game *game) {
+    hashFormation(game);
+    rehashBunkers(game->bunkers);
+    game->hash.lanes[HASH_PROJECTILES] = 0;
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        Projectiles *projectiles = game->projectiles[kind];
+        game->hash.lanes[HASH_PROJECTILES] += hashProjectiles(projectiles, 0, projectiles->count, mixHash(kind + 1));
+    }
+    finishStateHash(game);
+}
+
+int rewindFrameCapacity() {
+    const int projectileSize = 2*sizeof(Coord) + sizeof(uint8_t);
+    return sizeof(HotGameData) + TIMER_PACKED_CAPACITY + sizeof(Animation) + 2*sizeof(Rectangle) +
+        HORDE_SIZE*(sizeof(Rectangle) + sizeof(bool)) +
+        PROJECTILE_KIND_COUNT*(sizeof(int) + PROJECTILES_CAPACITY*projectileSize) +
+        BUNKER_COUNT*BUNKER_ROWS*sizeof(uint64_t);
+}
+
+uint8_t *pushBytes(uint8_t *cursor, const void *data, int size) {
+    memcpy(cursor, data, size);
+    return cursor + size;
+}
+
+const uint8_t *popBytes(const uint8_t *cursor, void *data, int size) {
+    memcpy(data, cursor, size);
+    return cursor + size;
+}
+
+uint8_t *saveProjectiles(uint8_t *cursor, Projectiles *projectiles) {
+    int count = projectiles->count;
+    cursor = pushBytes(cursor, &count, sizeof(int));
+    cursor = pushBytes(cursor, projectiles->x, count*sizeof(Coord));
+    cursor = pushBytes(cursor, projectiles->y, count*sizeof(Coord));
+    cursor = pushBytes(cursor, projectiles->alive, count*sizeof(uint8_t));
+    return cursor;
+}
+
+const uint8_t *loadProjectiles(const uint8_t *cursor, Projectiles *projectiles) {
+    int count;
+    cursor = popBytes(cursor, &count, sizeof(int));
+    clearProjectiles(projectiles);
+    cursor = popBytes(cursor, projectiles->x, count*sizeof(Coord));
+    cursor = popBytes(cursor, projectiles->y, count*sizeof(Coord));
+    cursor = popBytes(cursor, projectiles->alive, count*sizeof(uint8_t));
+    projectiles->count = count;
+    return cursor;
+}
+
+// Unchanged state has to stay at the same offsets from one frame to the
+// next for the XOR deltas to come out mostly zeros. Everything of a fixed
+// size goes first. The timers and projectiles come and go, so they go last,
+// where their length only shifts what follows them.
+int saveRewindFrame(Game *game, uint8_t *frame) {
+    uint8_t *cursor = frame;
+    cursor = pushBytes(cursor, game->hotData, sizeof(HotGameData));
+    cursor = pushBytes(cursor, game->animation, sizeof(Animation));
+    cursor = pushBytes(cursor, &game->ship->bounds, sizeof(Rectangle));
+    cursor = pushBytes(cursor, &game->enemyShip->bounds, sizeof(Rectangle));
+    for (int i = 1; i <= HORDE_SIZE; ++i) {
+        cursor = pushBytes(cursor, &game->horde[i].bounds, sizeof(Rectangle));
+        cursor = pushBytes(cursor, &game->horde[i].alive, sizeof(bool));
+    }
+    cursor = pushBytes(cursor, game->bunkers->cells, game->bunkers->count*sizeof(*game->bunkers->cells));
+    cursor += packTimerWheel(game->timers, cursor);
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        cursor = saveProjectiles(cursor, game->projectiles[kind]);
+    }
+
+    return cursor - frame;
+}
+
+void loadRewindFrame(Game *game, const uint8_t *frame) {
+    const uint8_t *cursor = frame;
+    Input input = game->hotData->input;
+    int wave = game->hotData->wave;
+
+    cursor = popBytes(cursor, game->hotData, sizeof(HotGameData));
+    // Stepping back over a wave change needs that wave's kinds back, the
+    // positions and alive flags below then overwrite the fresh layout
+    if (game->hotData->wave != wave) resetHorde(game->horde, currentWave(game), game->alienKindStart);
+    cursor = popBytes(cursor, game->animation, sizeof(Animation));
+    cursor = popBytes(cursor, &game->ship->bounds, sizeof(Rectangle));
+    cursor = popBytes(cursor, &game->enemyShip->bounds, sizeof(Rectangle));
+    for (int i = 1; i <= HORDE_SIZE; ++i) {
+        cursor = popBytes(cursor, &game->horde[i].bounds, sizeof(Rectangle));
+        cursor = popBytes(cursor, &game->horde[i].alive, sizeof(bool));
+    }
+    cursor = popBytes(cursor, game->bunkers->cells, game->bunkers->count*sizeof(*game->bunkers->cells));
+    memset(game->bunkers->dirty, 1, game->bunkers->count);
+    cursor += unpackTimerWheel(game->timers, cursor);
+    for (int kind = 0; kind < PROJECTILE_KIND_COUNT; ++kind) {
+        cursor = loadProjectiles(cursor, game->projectiles[kind]);
+    }
+
+    game->hordeLastAlive = relinkHorde(game->horde);
+    game->hotData->input = input;
+}
+
+void recordRewind(Game *game) {
+    int size = saveRewindFrame(game, game->rewindFrame);
+    recordRewindFrame(game->rewind, game->rewindFrame, size, combineStateHash(&game->hash));
+}
+
+// Steps one recorded frame back and forgets everything after it, so
+// recording picks up from there as soon as the button is released
+void stepBack(Game *game) {
+    uint32_t tick = game->rewind->tick - 2;
+    if (game->rewind->tick >= 2 && restoreRewindFrame(game->rewind, tick, game->rewindFrame) > 0) {
+        loadRewindFrame(game, game->rewindFrame);
+        rehashState(game);
+        uint64_t expected = rewindFrameHash(game->rewind, tick);
+        if (combineStateHash(&game->hash) != expected) {
+            TraceLog(LOG_WARNING, "REWIND: State hash of frame %u doesn't match its recording", tick);
+        }
+        truncateRewind(game->rewind, tick);
+        game->frameStats.events |= EVENT_REWOUND;
+        if (!IsMusicStreamPlaying(game->sounds->background)) PlayMusicStream(game->sounds->background);
+    }
+}
+
+// Goes out before telemetry clears the tick's phase times
+static const uint8_t publishedStates[] = {
+    [MENU] = METRICS_MENU,
+    [PLAYING] = METRICS_PLAYING,
+    [PAUSED] = METRICS_PAUSED,
+    [LOSE] = METRICS_LOSE,
+    [WIN] = METRICS_WIN,
+    [CLOSE] = METRICS_CLOSE,
+};
+
+void publishLiveMetrics(Game *game) {
+    TelemetryRecord *stats = &game->frameStats;
+    HotGameData *hotData = game->hotData;
+    LiveMetrics metrics;
+
+    int aliensAlive = 0;
+    for (int i = 1; i <= HORDE_SIZE; ++i) aliensAlive += game->horde[i].alive;
+
+    metrics.simTime = (double)hotData->simTicks/TIMER_TICK_RATE;
+    metrics.fastShotRemaining = timerSeconds(game, hotData->fastShotTimer);
+    metrics.fastMoveRemaining = timerSeconds(game, hotData->fastMoveTimer);
+    // Headless runs have no window to time, they report the frame replayed
+    if (game->headless) {
+        metrics.fps = game->frameTime > 0.0 ? 1.0/game->frameTime : 0.0f;
+        metrics.frameTime = game->frameTime;
+    } else {
+        metrics.fps = GetFPS();
+        metrics.frameTime = GetFrameTime();
+    }
+    metrics.tickTime = stats->collisionTime + stats->shipTime + stats->hordeTime +
+        stats->enemyShipTime + stats->projectileTime + stats->particleTime;
+    metrics.timeScale = game->coldData->timeScale;
+    metrics.aliensAlive = aliensAlive;
+    metrics.playerBullets = game->projectiles[PLAYER_BULLET]->count;
+    metrics.enemyBullets = game->projectiles[ENEMY_BULLET]->count;
+    metrics.powerups = game->projectiles[SHOT_POWERUP]->count + game->projectiles[MOVE_POWERUP]->count;
+    metrics.particles = game->particles->count;
+    metrics.gameState = publishedStates[hotData->gameState];
+    metrics.wave = hotData->wave;
+    metrics.fastShotActive = hotData->fastShotActive;
+    metrics.fastMoveActive = hotData->fastMoveActive;
+    metrics.enemyShipActive = hotData->enemyShipActive;
+    publishMetrics(game->metrics, &metrics);
+}
+
+// Counts are taken at the end of the tick, everything else was gathered
+// while it ran
+void recordTelemetry(Game *game, GameState previousState) {
+    TelemetryRecord *stats = &game->frameStats;
+    double now = perfClock();
+
+    if (game->telemetry != NULL) {
+        int aliensAlive = 0;
+        for (int i = 1; i <= HORDE_SIZE; ++i) aliensAlive += game->horde[i].alive;
+
+        stats->frameTime = now - game->lastTelemetryTime;
+        stats->particles = game->particles->count;
+        stats->aliensAlive = aliensAlive;
+        stats->playerBullets = game->projectiles[PLAYER_BULLET]->count;
+        stats->enemyBullets = game->projectiles[ENEMY_BULLET]->count;
+        stats->powerups = game->projectiles[SHOT_POWERUP]->count + game->projectiles[MOVE_POWERUP]->count;
+        stats->gameState = game->hotData->gameState;
+        stats->wave = game->hotData->wave;
+        if (game->hotData->gameState != previousState) stats->events |= EVENT_STATE_CHANGED;
+        stats->stateHash = combineStateHash(&game->hash);
+        for (int lane = 0; lane < HASH_LANES; ++lane) {
+            stats->laneHashes[lane] = (uint32_t)game->hash.lanes[lane];
+        }
+        writeTelemetry(game->telemetry, stats);
+    }
+
+    memset(stats, 0, sizeof(TelemetryRecord));
+    game->lastTelemetryTime = now;
+}
+
+// Into the tick's record, which is written once the frame is drawn
+void recordRenderStats(Game *game) {
+    TelemetryRecord *stats = &game->frameStats;
+    RenderStats frame = endRecordedFrame(game->recorder);
+
+    stats->drawCalls = frame.drawCalls > UINT16_MAX ? UINT16_MAX : (uint16_t)frame.drawCalls;
+    stats->textureSwitches = frame.textureSwitches > UINT16_MAX ? UINT16_MAX : (uint16_t)frame.textureSwitches;
+    stats->glyphs = frame.glyphs > UINT16_MAX ? UINT16_MAX : (uint16_t)frame.glyphs;
+    stats->quads = frame.quads > UINT32_MAX ? UINT32_MAX : (uint32_t)frame.quads;
+    stats->coveredPixels = frame.coveredPixels > UINT32_MAX ? UINT32_MAX : (uint32_t)frame.coveredPixels;
+}
+
+// Per frame averages and peaks, overdraw is covered pixels over the screen
+void reportRenderStats(RecordingBackend *recorder) {
+    if (recorder->frames == 0) return;
+
+    double frames = (double)recorder->frames;
+    double screen = (double)recorder->screenWidth*recorder->screenHeight;
+    RenderStats *total = &recorder->total;
+    RenderStats *peak = &recorder->peak;
+    TraceLog(
+        LOG_INFO,
+        "RENDER: per frame: draw calls %.1f (peak %llu), texture switches %.1f (peak %llu), quads %.1f (peak %llu), glyphs %.1f (peak %llu)",
+        total->drawCalls/frames, (unsigned long long)peak->drawCalls,
+        total->textureSwitches/frames, (unsigned long long)peak->textureSwitches,
+        total->quads/frames, (unsigned long long)peak->quads,
+        total->glyphs/frames, (unsigned long long)peak->glyphs
+    );
+    TraceLog(
+        LOG_INFO,
+        "RENDER: overdraw %.2fx (peak %.2fx) over %llu frames",
+        total->coveredPixels/frames/screen,
+        peak->coveredPixels/screen,
+        (unsigned long long)recorder->frames
+    );
+}
+
+// Per step averages, so runs of different lengths compare directly
+// Every limit the worst frame went over is logged, not just the first
+bool checkRenderBudget(RecordingBackend *recorder, const RenderBudget *budget) {
+    const RenderStats *peak = &recorder->peak;
+    float overdraw = peak->coveredPixels/(recorder->screenWidth*recorder->screenHeight);
+    bool within = true;
+
+    if (budget->drawCalls > 0 && peak->drawCalls > budget->drawCalls) {
+        TraceLog(LOG_ERROR, "RENDER: %llu draw calls in a frame, over the budget of %llu",
+            (unsigned long long)peak->drawCalls, (unsigned long long)budget->drawCalls);
+        within = false;
+    }
+    if (budget->textureSwitches > 0 && peak->textureSwitches > budget->textureSwitches) {
+        TraceLog(LOG_ERROR, "RENDER: %llu texture switches in a frame, over the budget of %llu",
+            (unsigned long long)peak->textureSwitches, (unsigned long long)budget->textureSwitches);
+        within = false;
+    }
+    if (budget->quads > 0 && peak->quads > budget->quads) {
+        TraceLog(LOG_ERROR, "RENDER: %llu quads in a frame, over the budget of %llu",
+            (unsigned long long)peak->quads, (unsigned long long)budget->quads);
+        within = false;
+    }
+    if (budget->overdraw > 0.0f && overdraw > budget->overdraw) {
+        TraceLog(LOG_ERROR, "RENDER: %.2fx overdraw in a frame, over the budget of %.2fx", overdraw, budget->overdraw);
+        within = false;
+    }
+
+    return within;
+}
+
+void reportPerf(PerfHarness *perf) {
+    static const char *phaseNames[PERF_PHASE_COUNT] = {
+        [PERF_COLLISIONS] = "collisions",
+        [PERF_SHIP] = "ship",
+        [PERF_HORDE] = "horde",
+        [PERF_ENEMY_SHIP] = "enemy ship",
+        [PERF_PROJECTILES] = "projectiles",
+    };
+    static const char *counterNames[PERF_COUNTER_COUNT] = {
+        [PERF_CYCLES] = "cycles",
+        [PERF_INSTRUCTIONS] = "instructions",
+        [PERF_L1D_MISSES] = "L1D misses",
+        [PERF_LLC_MISSES] = "LLC misses",
+        [PERF_BRANCH_MISSES] = "branch misses",
+    };
+
+    for (int phase = 0; phase < PERF_PHASE_COUNT; ++phase) {
+        uint64_t samples = perf->samples[phase];
+        if (samples == 0) continue;
+
+        char line[256];
+        int length = 0;
+        for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+            if (!perfCounterAvailable(perf, counter)) continue;
+            length += snprintf(
+                line + length,
+                sizeof(line) - length,
+                "%s %.0f, ",
+                counterNames[counter],
+                (double)perf->totals[phase][counter]/samples
+            );
+        }
+        const uint64_t *totals = perf->totals[phase];
+        double ipc = totals[PERF_CYCLES] ? (double)totals[PERF_INSTRUCTIONS]/totals[PERF_CYCLES] : 0.0;
+        TraceLog(LOG_INFO, "PERF: %s per step: %sIPC %.2f (%llu steps)", phaseNames[phase], line, ipc, (unsigned long long)samples);
+    }
+    resetPerfHarness(perf);
+}
+
+bool canRewind(Game *game) {
+    GameState gameState = game->hotData->gameState;
+    return game->hotData->input.rewind && (gameState == PLAYING || gameState == WIN || gameState == LOSE);
+}
+
+// Moves the clock on to this frame and queues its input. A replay brings
+// both, so it plays out the same however fast it runs and needs no window.
+// False once the replay runs out.
+bool nextFrame(Game *game) {
+    if (game->inputReplay != NULL) {
+        Input input;
+        if (!readInputFrame(game->inputReplay, &game->frameTime, &input, &game->replayHash)) {
+            TraceLog(LOG_INFO, "INPUT: Replay finished");
+            return false;
+        }
+        pushInputSample(game->inputQueue, input, 0.0);
+    } else {
+        game->frameTime = GetTime() - game->clock;
+        if (game->inputSampler == NULL) sampleInput(game);
+    }
+    game->clock += game->frameTime;
+    return true;
+}
+
+// Only the first frame off the recording is reported, every frame after it
+// differs because of it
+void checkReplayHash(Game *game, uint32_t stateHash) {
+    if (!game->replayDiverged && stateHash != game->replayHash) {
+        TraceLog(LOG_WARNING, "INPUT: Replay diverged from its recording at frame %u", game->replayFrame);
+        game->replayDiverged = true;
+    }
+    game->replayFrame++;
+}
+
+void countWorker(void *perf, int thread) {
+    openPerfThread((PerfHarness *)perf, thread);
+}
+
+int mainLoop(Options *options) {
     Game game = {.screenHeight=1080.0f, .screenWidth=1920.0f};
-    srand(time(NULL));
-    SetConfigFlags(FLAG_MSAA_4X_HINT);
-    InitWindow(game.screenWidth, game.screenHeight, "Space Invaders Clone");
-    InitAudioDevice();
-    SetExitKey(KEY_NULL);
-    DisableCursor();
+    game.headless = options->renderMode == RENDER_HEADLESS;
+    game.inputReplay = NULL;
+    game.replayFrame = 0;
+    game.replayDiverged = false;
+    if (options->inputReplayPath != NULL) {
+        game.inputReplay = openInputLog(options->inputReplayPath);
+        if (game.inputReplay == NULL) {
+            TraceLog(LOG_ERROR, "INPUT: Could not read replay %s", options->inputReplayPath);
+            return 1;
+        }
+    } else if (game.headless) {
+        TraceLog(LOG_ERROR, "RENDER: A headless run needs a replay to drive it");
+        return 1;
+    }
+    if (!game.headless) {
+        SetConfigFlags(FLAG_MSAA_4X_HINT);
+        InitWindow(game.screenWidth, game.screenHeight, "Space Invaders Clone");
+        InitAudioDevice();
+        SetExitKey(KEY_NULL);
+        DisableCursor();
+    }
 
+    // Ahead of the job system, so every worker opens its own counters
+    game.perf = NULL;
+    if (options->perfCounters) {
+        game.perf = openPerfHarness();
+        if (game.perf == NULL) TraceLog(LOG_WARNING, "PERF: No hardware counter could be opened");
+    }
+    game.jobs = createJobSystem(0, game.perf != NULL ? countWorker : NULL, game.perf);
+    game.soundCache = createSoundCache();
+    game.level = loadLevel("assets/levels/waves.lvl", HORDE_SIZE, ALIEN_KIND_COUNT);
+    game.net = NULL;
+    if (options->netRole != NET_OFF) {
+        game.net = openNetSession(
+            options->netRole,
+            options->netAddress,
+            options->netPort,
+            options->netLossRate,
+            options->netLatency
+        );
+        if (game.net == NULL) TraceLog(LOG_WARNING, "NET: Could not open session on port %i", options->netPort);
+    }
+    game.rewind = createRewindBuffer(REWIND_BUDGET, rewindFrameCapacity());
+    game.rewindFrame = (uint8_t *)malloc(rewindFrameCapacity());
+    game.inputQueue = createInputQueue();
+    game.inputLatency = (InputLatency *)calloc(1, sizeof(InputLatency));
+    RenderBackend *raylibBackend = createRaylibBackend();
+    game.renderer = raylibBackend;
+    game.recorder = NULL;
+    if (options->renderMode != RENDER_DIRECT) {
+        game.recorder = createRecordingBackend(
+            game.headless ? NULL : raylibBackend,
+            game.screenWidth,
+            game.screenHeight
+        );
+        game.renderer = &game.recorder->base;
+    }
     initGame(&game);
-
-    while (game.hotData->gameState != CLOSE) {
-        processInput(&game.hotData->input);
-        updateGame(&game);
-        BeginDrawing();
+    // A replay is only the same game with the seed and time scale it was
+    // recorded with
+    uint64_t seed = options->seed != 0 ? options->seed : (uint64_t)time(NULL);
+    float timeScale = options->timeScale;
+    if (game.inputReplay != NULL) {
+        seed = game.inputReplay->header.seed;
+        timeScale = game.inputReplay->header.timeScale;
+    }
+    game.coldData->bulletInterception = options->bulletInterception;
+    game.coldData->timeScale = timeScale;
+    game.inputRecord = NULL;
+    if (options->inputRecordPath != NULL) {
+        game.inputRecord = createInputLog(options->inputRecordPath, seed, timeScale);
+        if (game.inputRecord == NULL) TraceLog(LOG_WARNING, "INPUT: Could not create %s", options->inputRecordPath);
+    }
+    game.telemetry = NULL;
+    if (options->telemetryPath != NULL) {
+        game.telemetry = openTelemetry(options->telemetryPath, TELEMETRY_DEFAULT_CAPACITY);
+        if (game.telemetry == NULL) TraceLog(LOG_WARNING, "TELEMETRY: Could not map %s", options->telemetryPath);
+    }
+    game.metrics = NULL;
+    if (options->metricsName != NULL) {
+        game.metrics = openMetricsPublisher(options->metricsName);
+        if (game.metrics == NULL) TraceLog(LOG_WARNING, "METRICS: Could not create segment %s", options->metricsName);
+    }
+    memset(&game.frameStats, 0, sizeof(TelemetryRecord));
+    seedRandom(&game.hotData->random, seed);
+    // Particles are only for show but still count towards the draw costs, a
+    // replay should draw the same ones
+    seedRandom(&game.particles->random, mixHash(seed));
+    memset(&game.hash, 0, sizeof(StateHash));
+    rehashState(&game);
+    game.lastTelemetryTime = perfClock();
+
+    game.heldInput = (Input){.left=false};
+    game.inputSampler = NULL;
+    if (game.inputReplay == NULL) {
+        game.inputSampler = startInputSampler(game.inputQueue);
+        if (game.inputSampler == NULL) {
+            TraceLog(LOG_WARNING, "INPUT: No readable evdev device, sampling once per frame without latency stats");
+        }
+    }
+    game.inputLatency->lastReport = inputClock();
+    game.clock = game.inputReplay != NULL ? 0.0 : GetTime();
+    while (game.hotData->gameState != CLOSE && nextFrame(&game)) {
+        GameState previousState = game.hotData->gameState;
+        drainInput(&game);
+        // Rewinding loads the input of the frame it lands on
+        Input input = game.hotData->input;
+        if (game.net != NULL && game.net->role == NET_SPECTATOR) {
+            updateSpectator(&game);
+        } else if (canRewind(&game)) {
+            stepBack(&game);
+            if (game.net != NULL) publishSnapshot(&game);
+        } else {
+            bool simulated = game.hotData->gameState == PLAYING;
+            updateGame(&game);
+            finishStateHash(&game);
+            if (simulated && game.hotData->gameState != MENU) recordRewind(&game);
+            if (game.net != NULL) publishSnapshot(&game);
+        }
+        uint32_t stateHash = (uint32_t)combineStateHash(&game.hash);
+        if (game.inputRecord != NULL) writeInputFrame(game.inputRecord, game.frameTime, input, stateHash);
+        if (game.inputReplay != NULL) checkReplayHash(&game, stateHash);
+        if (game.metrics != NULL) publishLiveMetrics(&game);
+        if (game.headless) {
             drawGame(&game);
-        EndDrawing();
+        } else {
+            BeginDrawing();
+                drawGame(&game);
+            EndDrawing();
+        }
+        presentInput(&game, inputClock());
+        if (game.recorder != NULL) recordRenderStats(&game);
+        recordTelemetry(&game, previousState);
+    }
+    if (game.inputSampler != NULL) stopInputSampler(game.inputSampler);
+    reportInputLatency(game.inputLatency);
+    if (game.perf != NULL) reportPerf(game.perf);
+    bool withinBudget = true;
+    if (game.recorder != NULL) {
+        reportRenderStats(game.recorder);
+        withinBudget = checkRenderBudget(game.recorder, &options->renderBudget);
     }
 
     cleanupGame(&game);
-    CloseAudioDevice();
-    CloseWindow();
+    freeJobSystem(game.jobs);
+    freeSoundCache(game.soundCache);
+    freeLevel(game.level);
+    if (game.net != NULL) {
+        if (game.net->link->overflows > 0) {
+            TraceLog(LOG_WARNING, "NET: Dropped %u packets on a full latency queue", game.net->link->overflows);
+        }
+        if (game.net->truncatedSnapshots > 0) {
+            TraceLog(LOG_WARNING, "NET: %u snapshots left projectiles out", game.net->truncatedSnapshots);
+        }
+        closeNetSession(game.net);
+    }
+    if (game.telemetry != NULL) closeTelemetry(game.telemetry);
+    if (game.perf != NULL) closePerfHarness(game.perf);
+    if (game.metrics != NULL) closeMetricsPublisher(game.metrics);
+    if (game.recorder != NULL) freeRenderBackend(&game.recorder->base);
+    freeRenderBackend(raylibBackend);
+    freeRewindBuffer(game.rewind);
+    free(game.rewindFrame);
+    freeInputQueue(game.inputQueue);
+    free(game.inputLatency);
+    if (game.inputRecord != NULL) closeInputLog(game.inputRecord);
+    if (game.inputReplay != NULL) closeInputLog(game.inputReplay);
+    if (!game.headless) {
+        CloseAudioDevice();
+        CloseWindow();
+    }
+
+    return withinBudget && !game.replayDiverged ? 0 : 1;
 }
@@ -3,8 +3,31 @@
 
 # include <stdlib.h>
 # include "entity.h"
+# include "level.h"
+# include "jobs.h"
+# include "net.h"
+# include "rewind.h"
+# include "audio.h"
+# include "input.h"
+# include "particles.h"
+# include "bunker.h"
+# include "mask.h"
+# include "telemetry.h"
+# include "random.h"
+# include "hash.h"
+# include "timer.h"
+# include "perf.h"
+# include "metrics.h"
+# include "render.h"
 # include "raylib.h"
 
+// Timer wheel ticks per simulated second
+# define TIMER_TICK_RATE 120
+// The simulation only ever advances in steps of exactly this long, one timer
+// tick each. A frame runs as many as its time covers up to a cap past which
+// the game slows down.
+# define STEP_DELTA (1.0f/TIMER_TICK_RATE)
+# define MAX_STEPS_PER_FRAME 256
 
 typedef enum GameState {
     MENU,
@@ -26,60 +49,88 @@ typedef enum MenuButton {
     RESTART,
 } MenuButton;
 
-typedef struct Input {
-    bool left;
-    bool right;
-    bool fire;
-    bool select;
-    bool up;
-    bool down;
-    bool pause;
-} Input;
+typedef enum TimerEvent {
+    // The payload is the powerup's ProjectileKind
+    TIMER_POWERUP_ENDS,
+    TIMER_ENEMY_SHIP_ARRIVES,
+    TIMER_ALIEN_FRAME,
+    TIMER_SHIP_RELOADED,
+    TIMER_ENEMY_SHIP_RELOADED,
+} TimerEvent;
+
+typedef struct Options {
+    NetRole netRole;
+    const char *netAddress;
+    int netPort;
+    float netLossRate;
+    float netLatency;
+    bool bulletInterception;
+    const char *telemetryPath;
+    // 0 seeds from the clock
+    uint64_t seed;
+    // Simulated seconds per wall clock second
+    float timeScale;
+    // Hardware counters per update phase, reported on exit
+    bool perfCounters;
+    // Shared memory segment live metrics go to, NULL publishes none
+    const char *metricsName;
+    // Whether draw costs are counted and whether anything is drawn at all
+    RenderMode renderMode;
+    // Every frame's input and frame time go here, NULL records nothing
+    const char *inputRecordPath;
+    // Plays a recording back instead of reading input, the run ends with it
+    const char *inputReplayPath;
+    // A counted run that goes over it exits with an error
+    RenderBudget renderBudget;
+} Options;
 
 typedef struct ColdGameData {
     float shipSpeeds[2];
     float shipDelaysToFire[2];
     float screenLimits[2];
-    float enemyShipDelayToFire;
     float enemyShipSpeed;
     float projectileSpeed;
     float powerupDuration;
-    float hordeSpeedIncrease;
-    float hordeStepY;
-    float enemyShipSleepTime;
     float alienTimePerFrame;
+    float timeScale;
+    // Player and enemy bullets destroy each other on contact
+    bool bulletInterception;
 } ColdGameData;
 
 typedef struct HotGameData {
-    double fastShotRemainingTime;
-    double fastMoveRemainingTime;
-    double remainingTimeEnemyShipAlarm;
-    double lastFrameTime;
-    double shipLastShotTime;
-    double enemyShipLastShotTime;
+    // Steps simulated since the game started, the timer wheel runs on it
+    uint32_t simTicks;
+    TimerHandle fastShotTimer;
+    TimerHandle fastMoveTimer;
+    TimerHandle enemyShipTimer;
     float hordeSpeed;
+    int wave;
     GameState gameState;
     MenuButton menuButton;
     Input input;
+    // Kept here so rewind frames carry it along with the rest of the state
+    GameRandom random;
     bool fastShotActive;
     bool fastMoveActive;
     bool enemyShipGoingLeft;
     bool enemyShipDefeated;
     bool enemyShipActive;
     bool shipActive;
+    bool shipLoaded;
+    bool enemyShipLoaded;
 } HotGameData;
 
 typedef struct Sounds {
     Music background;
     Music enemyShip;
-    Sound shipFire;
-    Sound enemyFire;
-    Sound shipExplosion;
-    Sound enemyExplosion;
-    Sound powerup;
-    Sound lose;
-    Sound victory;
-    Sound menu;
+    SoundEffect shipFire;
+    SoundEffect enemyFire;
+    SoundEffect shipExplosion;
+    SoundEffect enemyExplosion;
+    SoundEffect powerup;
+    SoundEffect lose;
+    SoundEffect victory;
+    SoundEffect menu;
 } Sounds;
 
 typedef struct Textures {
@@ -93,13 +144,19 @@ typedef struct Textures {
     Texture2D movePowerup;
 } Textures;
 
+typedef struct Masks {
+    MaskSheet ship;
+    MaskSheet enemyShip;
+    MaskSheet aliens[ALIEN_KIND_COUNT];
+    MaskSheet projectiles[PROJECTILE_KIND_COUNT];
+} Masks;
+
 typedef struct Animation {
     Rectangle aliensFrame;
     Rectangle shipFrame;
     Rectangle bulletFrame;
     Rectangle enemyShipFrame;
     Rectangle powerupFrame;
-    float timeRemainingToChangeFrame;
     int enemyCurrentFrame;
 } Animation;
 
@@ -108,17 +165,65 @@ typedef struct Game {
     Entity *enemyShip;
     Entity *horde;
     Entity *hordeLastAlive;
-    Entity *bullets;
-    Entity *powerups;
+    Level *level;
+    Projectiles *projectiles[PROJECTILE_KIND_COUNT];
+    ParticleSystem *particles;
+    Bunkers *bunkers;
+    JobSystem *jobs;
+    NetSession *net;
+    RewindBuffer *rewind;
+    uint8_t *rewindFrame;
+    InputQueue *inputQueue;
+    InputLatency *inputLatency;
+    // NULL when input is read from raylib once per frame instead
+    InputSampler *inputSampler;
+    // Held keys as of the last sample drained
+    Input heldInput;
+    TimerWheel *timers;
+    PerfHarness *perf;
+    MetricsPublisher *metrics;
+    // Everything is drawn through renderer, recorder is set when it counts
+    RenderBackend *renderer;
+    RecordingBackend *recorder;
+    // No window and no audio device, only a replay can drive it
+    bool headless;
+    InputLog *inputRecord;
+    InputLog *inputReplay;
+    // The hash the recording ended the current frame on, and whether a frame
+    // has already come out different
+    uint32_t replayHash;
+    uint32_t replayFrame;
+    bool replayDiverged;
+    // Seconds since the start and since the last frame, from the window's
+    // clock or, when replaying, from the recording
+    double clock;
+    double frameTime;
+    Telemetry *telemetry;
+    // Filled in over the tick, committed and cleared once it ends
+    TelemetryRecord frameStats;
+    StateHash hash;
+    double lastTelemetryTime;
+    int *bulletHits;
+    // Aliens of one kind share a band of rows, kind k owns pool slots
+    // alienKindStart[k] up to alienKindStart[k + 1]
+    int alienKindStart[ALIEN_KIND_COUNT + 1];
     ColdGameData *coldData;
     HotGameData *hotData;
     Sounds *sounds;
+    SoundCache *soundCache;
     Textures *textures;
+    Masks *masks;
     Animation *animation;
     float screenHeight;
     float screenWidth;
+    // Simulated seconds the step being run covers
+    float stepDelta;
+    // Simulated seconds owed to the next frame, always less than a step
+    float stepDebt;
 } Game;
 
-void mainLoop();
+// The exit status for main, nonzero when the run could not start or went
+// over its render budget or a replay came out different from its recording
+int mainLoop(Options *);
 
 # endif
\ No newline at end of file
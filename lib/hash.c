@@ -0,0 +1,10 @@
+# include "hash.h"
+
+
+uint64_t combineStateHash(const StateHash *hash) {
+    uint64_t combined = 0;
+    for (int lane = 0; lane < HASH_LANES; ++lane) {
+        combined = hashCombine(combined, hash->lanes[lane]);
+    }
+    return combined;
+}
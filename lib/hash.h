@@ -0,0 +1,49 @@
+# ifndef _HASH_H_
+# define _HASH_H_
+
+# include <stdint.h>
+# include <string.h>
+
+typedef enum HashLane {
+    HASH_HOT,
+    HASH_FORMATION,
+    HASH_PROJECTILES,
+    HASH_BUNKERS,
+    HASH_RANDOM,
+    HASH_LANES,
+} HashLane;
+
+// One hash per subsystem, so two diverging runs show both the first tick
+// that differs and the subsystem it differs in
+typedef struct StateHash {
+    uint64_t lanes[HASH_LANES];
+    // XOR of the alive aliens' slot hashes, flipped one alien at a time
+    uint64_t aliveSet;
+} StateHash;
+
+// These run inside hot loops, so they live here to be inlined
+
+// splitmix64 finaliser
+static inline uint64_t mixHash(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+static inline uint64_t hashFloats(float first, float second) {
+    uint32_t a, b;
+    memcpy(&a, &first, sizeof(float));
+    memcpy(&b, &second, sizeof(float));
+    return mixHash((uint64_t)a << 32 | b);
+}
+
+static inline uint64_t hashCombine(uint64_t hash, uint64_t value) {
+    return mixHash(hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2)));
+}
+
+uint64_t combineStateHash(const StateHash *);
+
+# endif
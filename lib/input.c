@@ -0,0 +1,302 @@
+# include <stdlib.h>
+# include <string.h>
+# include <stdio.h>
+# include <time.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <unistd.h>
+# include <sys/ioctl.h>
+# include <linux/input.h>
+# include "input.h"
+
+
+# define STICK_DEADZONE 0.1f
+# define BITS_PER_LONG (8*sizeof(long))
+# define TEST_BIT(bits, bit) (((bits)[(bit)/BITS_PER_LONG] >> ((bit)%BITS_PER_LONG)) & 1)
+
+
+InputQueue *createInputQueue() {
+    InputQueue *queue = (InputQueue *)malloc(sizeof(InputQueue));
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+
+    return queue;
+}
+
+bool pushInputSample(InputQueue *queue, Input input, double sampledAt) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail == INPUT_QUEUE_CAPACITY) return false;
+
+    queue->samples[head % INPUT_QUEUE_CAPACITY] = (InputSample){.input=input, .sampledAt=sampledAt};
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool popInputSample(InputQueue *queue, InputSample *sample) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (head == tail) return false;
+
+    *sample = queue->samples[tail % INPUT_QUEUE_CAPACITY];
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void freeInputQueue(InputQueue *queue) {
+    free(queue);
+}
+
+double inputClock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+// Anything that can press space or the south face button counts
+bool openInputDevice(InputDevice *device, const char *path) {
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    unsigned long keys[KEY_MAX/BITS_PER_LONG + 1];
+    memset(keys, 0, sizeof(keys));
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0 ||
+        !(TEST_BIT(keys, KEY_SPACE) || TEST_BIT(keys, BTN_SOUTH))) {
+        close(fd);
+        return false;
+    }
+
+    // Event times have to be comparable with inputClock
+    int clock = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clock) < 0) {
+        close(fd);
+        return false;
+    }
+
+    device->fd = fd;
+    for (int axis = 0; axis < 2; ++axis) {
+        struct input_absinfo info;
+        bool found = ioctl(fd, EVIOCGABS(ABS_X + axis), &info) == 0 && info.maximum > info.minimum;
+        device->axisMin[axis] = found ? info.minimum : -1;
+        device->axisMax[axis] = found ? info.maximum : 1;
+    }
+
+    return true;
+}
+
+float normalizeAxis(InputDevice *device, int axis, int value) {
+    float range = (float)(device->axisMax[axis] - device->axisMin[axis]);
+    float position = 2.0f*(value - device->axisMin[axis])/range - 1.0f;
+    return position < STICK_DEADZONE && position > -STICK_DEADZONE ? 0.0f : position;
+}
+
+// Same mapping processInput gives raylib's input, presses only count on the
+// way down so key repeat never fires twice
+void applyInputEvent(InputSampler *sampler, InputDevice *device, struct input_event *event) {
+    if (event->type == EV_KEY) {
+        bool down = event->value != 0;
+        bool pressed = event->value == 1;
+        switch (event->code) {
+            case KEY_LEFT: sampler->keyLeft = down; break;
+            case KEY_RIGHT: sampler->keyRight = down; break;
+            case KEY_BACKSPACE: sampler->keyRewind = down; break;
+            case BTN_TL: sampler->padRewind = down; break;
+            case KEY_UP: sampler->pressed.up |= pressed; break;
+            case KEY_DOWN: sampler->pressed.down |= pressed; break;
+            case KEY_SPACE:
+            case BTN_SOUTH: sampler->pressed.fire |= pressed; break;
+            case KEY_ENTER:
+            case BTN_EAST: sampler->pressed.select |= pressed; break;
+            case KEY_ESC:
+            case BTN_START: sampler->pressed.pause |= pressed; break;
+            default: break;
+        }
+    } else if (event->type == EV_ABS && event->code == ABS_X) {
+        sampler->stickX = normalizeAxis(device, 0, event->value);
+    } else if (event->type == EV_ABS && event->code == ABS_Y) {
+        // The stick steps the menu once each time it leaves the deadzone
+        float stickY = normalizeAxis(device, 1, event->value);
+        sampler->pressed.up |= stickY > 0.0f && sampler->stickY <= 0.0f;
+        sampler->pressed.down |= stickY < 0.0f && sampler->stickY >= 0.0f;
+        sampler->stickY = stickY;
+    }
+}
+
+// Only changes are pushed, the consumer keeps held keys down until a sample
+// says otherwise
+void flushInputSample(InputSampler *sampler) {
+    Input sample = sampler->pressed;
+    sample.left = sampler->keyLeft || sampler->stickX < 0.0f;
+    sample.right = sampler->keyRight || sampler->stickX > 0.0f;
+    sample.rewind = sampler->keyRewind || sampler->padRewind;
+
+    Input pressed = sampler->pressed;
+    bool anyPressed = pressed.fire || pressed.select || pressed.up || pressed.down || pressed.pause;
+    bool heldChanged = sample.left != sampler->held.left || sample.right != sampler->held.right ||
+        sample.rewind != sampler->held.rewind;
+    if (!anyPressed && !heldChanged) {
+        sampler->pendingSince = 0.0;
+        return;
+    }
+
+    if (pushInputSample(sampler->queue, sample, sampler->pendingSince)) {
+        sampler->pressed = (Input){.fire=false};
+        sampler->held = sample;
+        sampler->pendingSince = 0.0;
+    }
+}
+
+void *runInputSampler(void *argument) {
+    InputSampler *sampler = (InputSampler *)argument;
+    struct pollfd fds[INPUT_MAX_DEVICES];
+    for (int i = 0; i < sampler->deviceCount; ++i) {
+        fds[i] = (struct pollfd){.fd=sampler->devices[i].fd, .events=POLLIN};
+    }
+
+    while (atomic_load_explicit(&sampler->running, memory_order_acquire)) {
+        if (poll(fds, sampler->deviceCount, INPUT_POLL_INTERVAL_MS) > 0) {
+            for (int i = 0; i < sampler->deviceCount; ++i) {
+                if (!(fds[i].revents & POLLIN)) continue;
+
+                struct input_event events[64];
+                ssize_t size;
+                while ((size = read(fds[i].fd, events, sizeof(events))) > 0) {
+                    for (size_t e = 0; e < (size_t)size/sizeof(struct input_event); ++e) {
+                        struct input_event *event = &events[e];
+                        if (event->type == EV_SYN) continue;
+                        if (sampler->pendingSince == 0.0) {
+                            sampler->pendingSince = event->input_event_sec + event->input_event_usec*1e-6;
+                        }
+                        applyInputEvent(sampler, &sampler->devices[i], event);
+                    }
+                }
+            }
+        }
+        if (sampler->pendingSince != 0.0) flushInputSample(sampler);
+    }
+
+    return NULL;
+}
+
+InputSampler *startInputSampler(InputQueue *queue) {
+    InputSampler *sampler = (InputSampler *)calloc(1, sizeof(InputSampler));
+    sampler->queue = queue;
+
+    for (int i = 0; i < 64 && sampler->deviceCount < INPUT_MAX_DEVICES; ++i) {
+        char path[32];
+        snprintf(path, sizeof(path), "/dev/input/event%d", i);
+        if (openInputDevice(&sampler->devices[sampler->deviceCount], path)) sampler->deviceCount++;
+    }
+
+    atomic_init(&sampler->running, true);
+    if (sampler->deviceCount == 0 || pthread_create(&sampler->thread, NULL, runInputSampler, sampler) != 0) {
+        for (int i = 0; i < sampler->deviceCount; ++i) close(sampler->devices[i].fd);
+        free(sampler);
+        return NULL;
+    }
+
+    return sampler;
+}
+
+void stopInputSampler(InputSampler *sampler) {
+    atomic_store_explicit(&sampler->running, false, memory_order_release);
+    pthread_join(sampler->thread, NULL);
+    for (int i = 0; i < sampler->deviceCount; ++i) close(sampler->devices[i].fd);
+    free(sampler);
+}
+
+uint8_t packButtons(Input input) {
+    return input.left | input.right << 1 | input.fire << 2 | input.select << 3 |
+        input.up << 4 | input.down << 5 | input.pause << 6 | input.rewind << 7;
+}
+
+Input unpackButtons(uint8_t buttons) {
+    return (Input){
+        .left=buttons & 1,
+        .right=buttons >> 1 & 1,
+        .fire=buttons >> 2 & 1,
+        .select=buttons >> 3 & 1,
+        .up=buttons >> 4 & 1,
+        .down=buttons >> 5 & 1,
+        .pause=buttons >> 6 & 1,
+        .rewind=buttons >> 7 & 1,
+    };
+}
+
+InputLog *createInputLog(const char *path, uint64_t seed, float timeScale) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return NULL;
+
+    InputLog *log = (InputLog *)malloc(sizeof(InputLog));
+    log->file = file;
+    log->header = (InputLogHeader){.version=INPUT_LOG_VERSION, .seed=seed, .timeScale=timeScale};
+    memcpy(log->header.magic, INPUT_LOG_MAGIC, 4);
+    fwrite(&log->header, sizeof(InputLogHeader), 1, file);
+
+    return log;
+}
+
+InputLog *openInputLog(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    InputLogHeader header;
+    if (fread(&header, sizeof(InputLogHeader), 1, file) != 1 ||
+        memcmp(header.magic, INPUT_LOG_MAGIC, 4) != 0 ||
+        header.version != INPUT_LOG_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+
+    InputLog *log = (InputLog *)malloc(sizeof(InputLog));
+    log->file = file;
+    log->header = header;
+
+    return log;
+}
+
+void writeInputFrame(InputLog *log, double frameTime, Input input, uint32_t stateHash) {
+    InputLogFrame frame = {.frameTime=frameTime, .buttons=packButtons(input), .stateHash=stateHash};
+    fwrite(&frame, sizeof(InputLogFrame), 1, log->file);
+}
+
+bool readInputFrame(InputLog *log, double *frameTime, Input *input, uint32_t *stateHash) {
+    InputLogFrame frame;
+    if (fread(&frame, sizeof(InputLogFrame), 1, log->file) != 1) return false;
+
+    *frameTime = frame.frameTime;
+    *input = unpackButtons(frame.buttons);
+    *stateHash = frame.stateHash;
+    return true;
+}
+
+void closeInputLog(InputLog *log) {
+    fclose(log->file);
+    free(log);
+}
+
+void recordLatency(LatencyStats *stats, double seconds) {
+    int bucket = (int)(seconds/LATENCY_BUCKET_WIDTH);
+    if (bucket < 0) bucket = 0;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+
+    stats->buckets[bucket]++;
+    stats->count++;
+}
+
+double latencyPercentile(LatencyStats *stats, double percentile) {
+    if (stats->count == 0) return 0.0;
+
+    uint32_t target = (uint32_t)(percentile*(stats->count - 1)) + 1;
+    uint32_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += stats->buckets[i];
+        if (seen >= target) return (i + 1)*LATENCY_BUCKET_WIDTH;
+    }
+
+    return LATENCY_BUCKETS*LATENCY_BUCKET_WIDTH;
+}
+
+void resetLatency(LatencyStats *stats) {
+    memset(stats, 0, sizeof(LatencyStats));
+}
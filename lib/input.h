@@ -0,0 +1,151 @@
+# ifndef _INPUT_H_
+# define _INPUT_H_
+
+# include <stdio.h>
+# include <stdbool.h>
+# include <stdint.h>
+# include <stdatomic.h>
+# include <pthread.h>
+
+# define INPUT_QUEUE_CAPACITY 256
+# define LATENCY_BUCKETS 1000
+# define LATENCY_BUCKET_WIDTH 0.00025
+# define LATENCY_REPORT_INTERVAL 10.0
+# define INPUT_MAX_DEVICES 8
+// The sampler wakes on every event, and at least this often to notice it is
+// being stopped or to retry a push the queue had no room for
+# define INPUT_POLL_INTERVAL_MS 1
+# define INPUT_LOG_MAGIC "SIIN"
+# define INPUT_LOG_VERSION 2
+
+typedef struct Input {
+    bool left;
+    bool right;
+    bool fire;
+    bool select;
+    bool up;
+    bool down;
+    bool pause;
+    bool rewind;
+} Input;
+
+// sampledAt is on the inputClock, taken from the kernel's timestamp of the
+// first event that went into the sample
+typedef struct InputSample {
+    Input input;
+    double sampledAt;
+} InputSample;
+
+// Single producer, single consumer. The producer only writes head and the
+// consumer only writes tail, so neither side ever takes a lock.
+typedef struct InputQueue {
+    InputSample samples[INPUT_QUEUE_CAPACITY];
+    atomic_uint head;
+    atomic_uint tail;
+} InputQueue;
+
+// Fixed-width histogram, a quarter millisecond per bucket up to 250ms
+typedef struct LatencyStats {
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+} LatencyStats;
+
+typedef struct InputDevice {
+    int fd;
+    int axisMin[2];
+    int axisMax[2];
+} InputDevice;
+
+// Reads keyboards and gamepads straight from evdev on its own thread, raylib
+// only polls on the main thread once per frame. Presses are kept until a
+// push gets through, so a full queue delays them but never loses one.
+typedef struct InputSampler {
+    InputDevice devices[INPUT_MAX_DEVICES];
+    InputQueue *queue;
+    pthread_t thread;
+    atomic_bool running;
+    int deviceCount;
+    // Everything below belongs to the sampler thread
+    Input pressed;
+    Input held;
+    double pendingSince;
+    float stickX;
+    float stickY;
+    bool keyLeft;
+    bool keyRight;
+    bool keyRewind;
+    bool padRewind;
+} InputSampler;
+
+// A recorded run starts with the seed and time scale it was played with, so
+// a replay reproduces it without being told either
+typedef struct InputLogHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t seed;
+    float timeScale;
+    uint32_t reserved;
+} InputLogHeader;
+
+// One per frame, the input the simulation drained, the frame time it ran
+// the frame with and the low half of the state hash it ended on, so a
+// replay can tell the first frame it went its own way. Buttons are the
+// Input fields in order, one bit each.
+typedef struct InputLogFrame {
+    double frameTime;
+    uint8_t buttons;
+    uint8_t reserved[3];
+    uint32_t stateHash;
+} InputLogFrame;
+
+_Static_assert(sizeof(InputLogFrame) == 16, "input log frames are 16 bytes");
+
+typedef struct InputLog {
+    FILE *file;
+    InputLogHeader header;
+} InputLog;
+
+typedef struct InputLatency {
+    LatencyStats toSimulation;
+    LatencyStats toPresent;
+    double oldestUnpresented;
+    double lastReport;
+    bool pendingPresent;
+} InputLatency;
+
+InputQueue *createInputQueue();
+
+bool pushInputSample(InputQueue *, Input, double sampledAt);
+
+bool popInputSample(InputQueue *, InputSample *);
+
+void freeInputQueue(InputQueue *);
+
+// Seconds on CLOCK_MONOTONIC, the clock evdev is asked to stamp events with
+double inputClock();
+
+// NULL when no keyboard or gamepad can be read, /dev/input usually needs
+// the input group
+InputSampler *startInputSampler(InputQueue *);
+
+void stopInputSampler(InputSampler *);
+
+InputLog *createInputLog(const char *path, uint64_t seed, float timeScale);
+
+// NULL when the file is missing or was not written by createInputLog
+InputLog *openInputLog(const char *path);
+
+void writeInputFrame(InputLog *, double frameTime, Input, uint32_t stateHash);
+
+// False once the log runs out
+bool readInputFrame(InputLog *, double *frameTime, Input *, uint32_t *stateHash);
+
+void closeInputLog(InputLog *);
+
+void recordLatency(LatencyStats *, double seconds);
+
+double latencyPercentile(LatencyStats *, double percentile);
+
+void resetLatency(LatencyStats *);
+
+# endif
@@ -0,0 +1,197 @@
+# include <stdlib.h>
+# include <sched.h>
+# include <unistd.h>
+# include "jobs.h"
+
+
+typedef struct Worker {
+    JobSystem *system;
+    int index;
+    JobThreadStart start;
+    void *context;
+    pthread_barrier_t *started;
+} Worker;
+
+bool pushJob(JobDeque *deque, Job job) {
+    bool pushed = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top < JOBS_DEQUE_CAPACITY) {
+        deque->jobs[deque->bottom % JOBS_DEQUE_CAPACITY] = job;
+        deque->bottom++;
+        pushed = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return pushed;
+}
+
+bool popJob(JobDeque *deque, Job *job) {
+    bool popped = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        deque->bottom--;
+        *job = deque->jobs[deque->bottom % JOBS_DEQUE_CAPACITY];
+        popped = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return popped;
+}
+
+bool stealJob(JobDeque *deque, Job *job) {
+    bool stolen = false;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        *job = deque->jobs[deque->top % JOBS_DEQUE_CAPACITY];
+        deque->top++;
+        stolen = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return stolen;
+}
+
+bool findJob(JobSystem *system, int index, Job *job) {
+    if (atomic_load(&system->queued) == 0) return false;
+
+    bool found = popJob(&system->deques[index], job);
+    for (int i = 1; !found && i < system->threadCount; ++i) {
+        found = stealJob(&system->deques[(index + i) % system->threadCount], job);
+    }
+
+    if (found) atomic_fetch_sub(&system->queued, 1);
+    return found;
+}
+
+void runJob(Job *job) {
+    job->function(job->context, job->chunk, job->begin, job->end);
+    atomic_fetch_sub(job->pending, 1);
+}
+
+void *workerMain(void *argument) {
+    Worker *worker = (Worker *)argument;
+    JobSystem *system = worker->system;
+    int index = worker->index;
+    Job job;
+    if (worker->start != NULL) worker->start(worker->context, index);
+    pthread_barrier_wait(worker->started);
+    free(worker);
+
+    while (atomic_load(&system->running)) {
+        if (findJob(system, index, &job)) {
+            runJob(&job);
+        } else {
+            pthread_mutex_lock(&system->sleepLock);
+            while (atomic_load(&system->running) && atomic_load(&system->queued) == 0) {
+                pthread_cond_wait(&system->wake, &system->sleepLock);
+            }
+            pthread_mutex_unlock(&system->sleepLock);
+        }
+    }
+
+    return NULL;
+}
+
+JobSystem *createJobSystem(int threadCount, JobThreadStart start, void *context) {
+    if (threadCount <= 0) threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > JOBS_MAX_THREADS) threadCount = JOBS_MAX_THREADS;
+
+    JobSystem *system = (JobSystem *)malloc(sizeof(JobSystem));
+    pthread_mutex_init(&system->sleepLock, NULL);
+    pthread_cond_init(&system->wake, NULL);
+    atomic_init(&system->queued, 0);
+    atomic_init(&system->running, true);
+    system->threadCount = threadCount;
+
+    for (int i = 0; i < threadCount; ++i) {
+        pthread_mutex_init(&system->deques[i].lock, NULL);
+        system->deques[i].top = 0;
+        system->deques[i].bottom = 0;
+    }
+
+    pthread_barrier_t started;
+    pthread_barrier_init(&started, NULL, threadCount);
+    for (int i = 1; i < threadCount; ++i) {
+        Worker *worker = (Worker *)malloc(sizeof(Worker));
+        worker->system = system;
+        worker->index = i;
+        worker->start = start;
+        worker->context = context;
+        worker->started = &started;
+        pthread_create(&system->threads[i], NULL, workerMain, worker);
+    }
+    pthread_barrier_wait(&started);
+    pthread_barrier_destroy(&started);
+
+    return system;
+}
+
+int jobChunkSize(int count, int minChunkSize) {
+    int chunkSize = (count + JOBS_MAX_CHUNKS - 1) / JOBS_MAX_CHUNKS;
+    return chunkSize > minChunkSize ? chunkSize : minChunkSize;
+}
+
+int parallelFor(JobSystem *system, int count, int chunkSize, JobFunction function, void *context) {
+    if (count <= 0) return 0;
+
+    int chunks = (count + chunkSize - 1) / chunkSize;
+    // Small loops are not worth waking anyone up for
+    if (chunks == 1 || system->threadCount == 1) {
+        for (int chunk = 0; chunk < chunks; ++chunk) {
+            int end = (chunk + 1)*chunkSize;
+            function(context, chunk, chunk*chunkSize, end < count ? end : count);
+        }
+        return chunks;
+    }
+
+    atomic_int pending;
+    atomic_init(&pending, chunks);
+
+    // Chunks are dealt round-robin so every worker starts on its own deque
+    // and only steals once it runs dry
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+        int end = (chunk + 1)*chunkSize;
+        Job job = {
+            .function=function,
+            .context=context,
+            .pending=&pending,
+            .chunk=chunk,
+            .begin=chunk*chunkSize,
+            .end=end < count ? end : count,
+        };
+
+        if (pushJob(&system->deques[chunk % system->threadCount], job)) {
+            atomic_fetch_add(&system->queued, 1);
+        } else {
+            runJob(&job);
+        }
+    }
+
+    pthread_mutex_lock(&system->sleepLock);
+    pthread_cond_broadcast(&system->wake);
+    pthread_mutex_unlock(&system->sleepLock);
+
+    // The caller works too, then joins
+    Job job;
+    while (atomic_load(&pending) > 0) {
+        if (findJob(system, 0, &job)) runJob(&job);
+        else sched_yield();
+    }
+
+    return chunks;
+}
+
+void freeJobSystem(JobSystem *system) {
+    pthread_mutex_lock(&system->sleepLock);
+    atomic_store(&system->running, false);
+    pthread_cond_broadcast(&system->wake);
+    pthread_mutex_unlock(&system->sleepLock);
+
+    for (int i = 1; i < system->threadCount; ++i) {
+        pthread_join(system->threads[i], NULL);
+    }
+    for (int i = 0; i < system->threadCount; ++i) {
+        pthread_mutex_destroy(&system->deques[i].lock);
+    }
+    pthread_mutex_destroy(&system->sleepLock);
+    pthread_cond_destroy(&system->wake);
+    free(system);
+}
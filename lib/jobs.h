@@ -0,0 +1,65 @@
+# ifndef _JOBS_H_
+# define _JOBS_H_
+
+# include <stdbool.h>
+# include <pthread.h>
+# include <stdatomic.h>
+
+// A small work-stealing pool for the simulation's data-parallel loops. Only
+// loops that can grow past a chunk go through it: integrating the projectile
+// pools and finding the alien each player bullet hits. A loop that fits in
+// one chunk runs inline without waking anyone. The horde is at most 55
+// aliens, less than a chunk, and is updated on the calling thread.
+// Anything linking this needs -pthread.
+
+# define JOBS_MAX_THREADS 16
+# define JOBS_MAX_CHUNKS 256
+# define JOBS_DEQUE_CAPACITY JOBS_MAX_CHUNKS
+
+// A job covers [begin, end) of a parallel loop. The chunk index is stable for
+// a given count and chunk size, whatever the number of threads, so callers
+// can keep per-chunk partial results and reduce them in chunk order.
+typedef void (*JobFunction)(void *context, int chunk, int begin, int end);
+
+// Runs once on every worker thread, with its deque index, before it takes
+// any job
+typedef void (*JobThreadStart)(void *context, int thread);
+
+typedef struct Job {
+    JobFunction function;
+    void *context;
+    atomic_int *pending;
+    int chunk;
+    int begin;
+    int end;
+} Job;
+
+// The owner pops from the bottom, thieves take from the top
+typedef struct JobDeque {
+    Job jobs[JOBS_DEQUE_CAPACITY];
+    pthread_mutex_t lock;
+    int top;
+    int bottom;
+} JobDeque;
+
+typedef struct JobSystem {
+    pthread_t threads[JOBS_MAX_THREADS];
+    JobDeque deques[JOBS_MAX_THREADS];
+    pthread_mutex_t sleepLock;
+    pthread_cond_t wake;
+    atomic_int queued;
+    atomic_bool running;
+    // Counts the calling thread, which owns deque 0
+    int threadCount;
+} JobSystem;
+
+// Returns once every worker has run start, which may be NULL
+JobSystem *createJobSystem(int threadCount, JobThreadStart start, void *context);
+
+int jobChunkSize(int count, int minChunkSize);
+
+int parallelFor(JobSystem *, int count, int chunkSize, JobFunction, void *context);
+
+void freeJobSystem(JobSystem *);
+
+# endif
@@ -0,0 +1,129 @@
+# include <stdlib.h>
+# include <stdio.h>
+# include <string.h>
+# include <stdbool.h>
+# include "level.h"
+# include "raylib.h"
+
+
+typedef struct LevelReader {
+    const uint8_t *data;
+    int size;
+    int position;
+    bool overflow;
+} LevelReader;
+
+uint32_t readLevelBytes(LevelReader *reader, int bytes) {
+    uint32_t value = 0;
+    if (reader->position + bytes > reader->size) {
+        reader->overflow = true;
+        return 0;
+    }
+    for (int i = 0; i < bytes; ++i) {
+        value |= (uint32_t)reader->data[reader->position++] << (8*i);
+    }
+    return value;
+}
+
+float readLevelFloat(LevelReader *reader) {
+    uint32_t bits = readLevelBytes(reader, 4);
+    float value;
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+// The formation the game shipped with before levels were data
+LevelWave defaultWave() {
+    return (LevelWave){
+        .bands={{.rows=2, .kind=0}, {.rows=1, .kind=1}, {.rows=2, .kind=2}},
+        .bandCount=3,
+        .rows=5,
+        .columns=11,
+        .hordeSpeed=100.0f,
+        .hordeSpeedIncrease=25.0f,
+        .hordeStepY=100.0f,
+        .fireChance=10,
+        .enemyShipSleepTime=4.0f,
+        .enemyShipDelayToFire=0.25f,
+    };
+}
+
+bool readWave(LevelReader *reader, LevelWave *wave, int maxAliens, int kindCount) {
+    wave->rows = readLevelBytes(reader, 1);
+    wave->columns = readLevelBytes(reader, 1);
+    wave->bandCount = readLevelBytes(reader, 1);
+    if (wave->bandCount < 1 || wave->bandCount > LEVEL_MAX_BANDS) return false;
+
+    int rows = 0;
+    int lastKind = 0;
+    for (int i = 0; i < wave->bandCount; ++i) {
+        wave->bands[i].rows = readLevelBytes(reader, 1);
+        wave->bands[i].kind = readLevelBytes(reader, 1);
+        // The horde keeps each kind in one contiguous slice of its pool
+        if (wave->bands[i].kind >= kindCount || wave->bands[i].kind < lastKind) return false;
+        lastKind = wave->bands[i].kind;
+        rows += wave->bands[i].rows;
+    }
+
+    wave->hordeSpeed = readLevelFloat(reader);
+    wave->hordeSpeedIncrease = readLevelFloat(reader);
+    wave->hordeStepY = readLevelFloat(reader);
+    wave->fireChance = readLevelBytes(reader, 4);
+    wave->enemyShipSleepTime = readLevelFloat(reader);
+    wave->enemyShipDelayToFire = readLevelFloat(reader);
+
+    return !reader->overflow &&
+        rows == wave->rows &&
+        wave->rows > 0 &&
+        wave->columns > 0 &&
+        wave->rows*wave->columns <= maxAliens &&
+        wave->hordeSpeed > 0.0f;
+}
+
+bool parseLevel(Level *level, const uint8_t *data, int size, int maxAliens, int kindCount) {
+    LevelReader reader = {.data=data, .size=size, .position=0, .overflow=false};
+
+    if (size < 6 || memcmp(data, LEVEL_MAGIC, 4) != 0) return false;
+    reader.position = 4;
+    if (readLevelBytes(&reader, 1) != LEVEL_VERSION) return false;
+
+    level->waveCount = readLevelBytes(&reader, 1);
+    if (level->waveCount < 1 || level->waveCount > LEVEL_MAX_WAVES) return false;
+    for (int i = 0; i < level->waveCount; ++i) {
+        if (!readWave(&reader, &level->waves[i], maxAliens, kindCount)) return false;
+    }
+
+    return reader.position == size;
+}
+
+Level *loadLevel(const char *path, int maxAliens, int kindCount) {
+    Level *level = (Level *)malloc(sizeof(Level));
+    uint8_t *data = NULL;
+    long size = -1;
+
+    FILE *file = fopen(path, "rb");
+    if (file != NULL) {
+        if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+        if (size > 0) {
+            data = (uint8_t *)malloc(size);
+            rewind(file);
+            if (fread(data, 1, size, file) != (size_t)size) size = -1;
+        }
+        fclose(file);
+    }
+
+    if (data == NULL || size <= 0 || !parseLevel(level, data, size, maxAliens, kindCount)) {
+        TraceLog(LOG_WARNING, "LEVEL: Could not load %s, using the built-in wave", path);
+        level->waves[0] = defaultWave();
+        level->waveCount = 1;
+    } else {
+        TraceLog(LOG_INFO, "LEVEL: Loaded %i waves from %s", level->waveCount, path);
+    }
+    free(data);
+
+    return level;
+}
+
+void freeLevel(Level *level) {
+    free(level);
+}
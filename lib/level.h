@@ -0,0 +1,51 @@
+# ifndef _LEVEL_H_
+# define _LEVEL_H_
+
+# include <stdint.h>
+
+# define LEVEL_MAX_WAVES 32
+# define LEVEL_MAX_BANDS 8
+# define LEVEL_MAGIC "SILV"
+# define LEVEL_VERSION 1
+
+// A band is a run of formation rows sharing one alien kind, bands go top
+// to bottom and never go back to an earlier kind
+typedef struct LevelBand {
+    uint8_t rows;
+    uint8_t kind;
+} LevelBand;
+
+// Named apart from raylib's audio Wave
+typedef struct LevelWave {
+    LevelBand bands[LEVEL_MAX_BANDS];
+    int bandCount;
+    int rows;
+    int columns;
+    float hordeSpeed;
+    float hordeSpeedIncrease;
+    float hordeStepY;
+    // Chance per alive alien per tick, out of a million
+    int fireChance;
+    float enemyShipSleepTime;
+    float enemyShipDelayToFire;
+} LevelWave;
+
+typedef struct Level {
+    LevelWave waves[LEVEL_MAX_WAVES];
+    int waveCount;
+} Level;
+
+// File layout, little endian:
+//   char magic[4], u8 version, u8 waveCount
+//   per wave:
+//     u8 rows, u8 columns, u8 bandCount, {u8 rows, u8 kind} * bandCount
+//     f32 hordeSpeed, f32 hordeSpeedIncrease, f32 hordeStepY,
+//     u32 fireChance, f32 enemyShipSleepTime, f32 enemyShipDelayToFire
+// The files are built from a text source by src/buildLevel.c, see
+// assets/levels/waves.txt. A missing or malformed file falls back to the
+// single built-in wave
+Level *loadLevel(const char *path, int maxAliens, int kindCount);
+
+void freeLevel(Level *);
+
+# endif
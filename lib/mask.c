@@ -0,0 +1,92 @@
+# include <stdlib.h>
+# include <math.h>
+# include "mask.h"
+# include "raylib.h"
+
+
+SpriteMask buildSpriteMask(Image image, Rectangle frame, int width, int height) {
+    SpriteMask mask = {.width=width, .height=height, .words=(width + 63)/64};
+    mask.bits = (uint64_t *)calloc(mask.words*height, sizeof(uint64_t));
+
+    // Nearest neighbour, the same sampling the sprites are drawn with
+    for (int y = 0; y < height; ++y) {
+        int sourceY = (int)frame.y + y*(int)frame.height/height;
+        for (int x = 0; x < width; ++x) {
+            int sourceX = (int)frame.x + x*(int)frame.width/width;
+            if (sourceX >= image.width || sourceY >= image.height) continue;
+            if (GetImageColor(image, sourceX, sourceY).a >= MASK_ALPHA_THRESHOLD) {
+                mask.bits[y*mask.words + x/64] |= 1ull << (x % 64);
+            }
+        }
+    }
+
+    return mask;
+}
+
+MaskSheet loadMaskSheet(const char *path, Rectangle frame, float width, float height) {
+    MaskSheet sheet = {.frameCount=0, .frameWidth=frame.width};
+    Image image = LoadImage(path);
+
+    int frames = frame.width > 0.0f ? image.width/(int)frame.width : 0;
+    if (frames < 1) frames = 1;
+    if (frames > MASK_MAX_FRAMES) frames = MASK_MAX_FRAMES;
+
+    for (int i = 0; i < frames; ++i) {
+        Rectangle source = frame;
+        source.x = i*frame.width;
+        sheet.frames[i] = buildSpriteMask(image, source, (int)width, (int)height);
+    }
+    sheet.frameCount = frames;
+    UnloadImage(image);
+
+    return sheet;
+}
+
+// The animation only ever moves the source rectangle along the sheet, and
+// the texture wraps, so the frame is its offset modulo the sheet
+const SpriteMask *sheetFrame(const MaskSheet *sheet, Rectangle frame) {
+    int index = (int)(frame.x/sheet->frameWidth) % sheet->frameCount;
+    if (index < 0) index += sheet->frameCount;
+    return &sheet->frames[index];
+}
+
+// 64 bits of a row starting at any column, zero past the end
+uint64_t maskSpan(const SpriteMask *mask, int row, int start) {
+    const uint64_t *words = &mask->bits[row*mask->words];
+    int word = start >> 6;
+    int bit = start & 63;
+    uint64_t low = word < mask->words ? words[word] >> bit : 0;
+    uint64_t high = bit && word + 1 < mask->words ? words[word + 1] << (64 - bit) : 0;
+    return low | high;
+}
+
+bool masksOverlap(const SpriteMask *mask, Rectangle bounds, const SpriteMask *other, Rectangle otherBounds) {
+    int x = (int)floorf(bounds.x);
+    int y = (int)floorf(bounds.y);
+    int otherX = (int)floorf(otherBounds.x);
+    int otherY = (int)floorf(otherBounds.y);
+
+    int left = x > otherX ? x : otherX;
+    int top = y > otherY ? y : otherY;
+    int right = x + mask->width < otherX + other->width ? x + mask->width : otherX + other->width;
+    int bottom = y + mask->height < otherY + other->height ? y + mask->height : otherY + other->height;
+
+    for (int row = top; row < bottom; ++row) {
+        for (int column = left; column < right; column += 64) {
+            int span = right - column;
+            uint64_t keep = span >= 64 ? ~0ull : (1ull << span) - 1;
+            if (maskSpan(mask, row - y, column - x) & maskSpan(other, row - otherY, column - otherX) & keep) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void unloadMaskSheet(MaskSheet *sheet) {
+    for (int i = 0; i < sheet->frameCount; ++i) {
+        free(sheet->frames[i].bits);
+    }
+    sheet->frameCount = 0;
+}
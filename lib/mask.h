@@ -0,0 +1,37 @@
+# ifndef _MASK_H_
+# define _MASK_H_
+
+# include <stdlib.h>
+# include <stdint.h>
+# include <stdbool.h>
+# include "raylib.h"
+
+# define MASK_MAX_FRAMES 8
+# define MASK_ALPHA_THRESHOLD 128
+
+// Opaque pixels of one sprite frame, already scaled to the size the entity
+// is drawn at. Rows are packed 64 pixels to a word, bit x is column x.
+typedef struct SpriteMask {
+    uint64_t *bits;
+    int width;
+    int height;
+    int words;
+} SpriteMask;
+
+// Every frame of a sprite sheet laid out side by side, as the animation
+// frames walk across it
+typedef struct MaskSheet {
+    SpriteMask frames[MASK_MAX_FRAMES];
+    int frameCount;
+    float frameWidth;
+} MaskSheet;
+
+MaskSheet loadMaskSheet(const char *path, Rectangle frame, float width, float height);
+
+const SpriteMask *sheetFrame(const MaskSheet *, Rectangle frame);
+
+bool masksOverlap(const SpriteMask *, Rectangle bounds, const SpriteMask *other, Rectangle otherBounds);
+
+void unloadMaskSheet(MaskSheet *);
+
+# endif
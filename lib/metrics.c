@@ -0,0 +1,114 @@
+# include <stdlib.h>
+# include <string.h>
+# include <errno.h>
+# include <fcntl.h>
+# include <signal.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include "metrics.h"
+
+
+MetricsPublisher *openMetricsPublisher(const char *name) {
+    if (strlen(name) >= sizeof(((MetricsPublisher *)0)->name)) return NULL;
+
+    int file = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) return NULL;
+    if (ftruncate(file, sizeof(MetricsSegment)) != 0) {
+        close(file);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    void *mapping = mmap(NULL, sizeof(MetricsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    // The mapping keeps the segment alive on its own
+    close(file);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    MetricsPublisher *publisher = (MetricsPublisher *)malloc(sizeof(MetricsPublisher));
+    publisher->segment = (MetricsSegment *)mapping;
+    publisher->frames = 0;
+    strcpy(publisher->name, name);
+
+    MetricsSegment *segment = publisher->segment;
+    memset(&segment->metrics, 0, sizeof(LiveMetrics));
+    memcpy(segment->magic, METRICS_MAGIC, 4);
+    segment->version = METRICS_VERSION;
+    segment->size = sizeof(MetricsSegment);
+    segment->pid = getpid();
+    atomic_store_explicit(&segment->sequence, 0, memory_order_release);
+
+    return publisher;
+}
+
+// The fences keep the copy between the two sequence bumps, a reader that
+// sees the same even sequence on both sides of its own copy got a whole one
+void publishMetrics(MetricsPublisher *publisher, LiveMetrics *metrics) {
+    MetricsSegment *segment = publisher->segment;
+    metrics->frame = publisher->frames++;
+    uint32_t sequence = atomic_load_explicit(&segment->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&segment->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    segment->metrics = *metrics;
+    atomic_store_explicit(&segment->sequence, sequence + 2, memory_order_release);
+}
+
+void closeMetricsPublisher(MetricsPublisher *publisher) {
+    munmap(publisher->segment, sizeof(MetricsSegment));
+    shm_unlink(publisher->name);
+    free(publisher);
+}
+
+MetricsSegment *attachMetrics(const char *name) {
+    int file = shm_open(name, O_RDONLY, 0);
+    if (file < 0) return NULL;
+
+    void *mapping = mmap(NULL, sizeof(MetricsSegment), PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) return NULL;
+
+    MetricsSegment *segment = (MetricsSegment *)mapping;
+    if (memcmp(segment->magic, METRICS_MAGIC, 4) != 0 ||
+        segment->version != METRICS_VERSION ||
+        segment->size != sizeof(MetricsSegment)) {
+        munmap(mapping, sizeof(MetricsSegment));
+        return NULL;
+    }
+
+    return segment;
+}
+
+bool readMetrics(const MetricsSegment *segment, LiveMetrics *metrics, int attempts) {
+    MetricsSegment *shared = (MetricsSegment *)segment;
+
+    for (int attempt = 0; attempt < attempts; ++attempt) {
+        uint32_t before = atomic_load_explicit(&shared->sequence, memory_order_acquire);
+        if (before & 1) continue;
+        *metrics = segment->metrics;
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t after = atomic_load_explicit(&shared->sequence, memory_order_relaxed);
+        if (before == after) return true;
+    }
+
+    return false;
+}
+
+// Signal 0 only checks the process exists, EPERM means it does but belongs
+// to someone else
+bool metricsPublisherAlive(const MetricsSegment *segment) {
+    return kill(segment->pid, 0) == 0 || errno == EPERM;
+}
+
+const char *metricsStateName(uint8_t state) {
+# define METRICS_STATE_NAME(state, name) [state] = name,
+    static const char *names[METRICS_STATE_COUNT] = {METRICS_STATES(METRICS_STATE_NAME)};
+# undef METRICS_STATE_NAME
+    return state < METRICS_STATE_COUNT ? names[state] : "?";
+}
+
+void detachMetrics(MetricsSegment *segment) {
+    munmap(segment, sizeof(MetricsSegment));
+}
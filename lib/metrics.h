@@ -0,0 +1,98 @@
+# ifndef _METRICS_H_
+# define _METRICS_H_
+
+# include <stdint.h>
+# include <stdbool.h>
+# include <stdatomic.h>
+
+# define METRICS_MAGIC "SILM"
+# define METRICS_VERSION 1
+# define METRICS_DEFAULT_NAME "/space-invaders-metrics"
+
+// Game states as published. Readers go by these rather than the game's own
+// enum, the game maps its states onto them by name.
+// X(state, name)
+# define METRICS_STATES(X) \
+    X(METRICS_MENU, "menu") \
+    X(METRICS_PLAYING, "playing") \
+    X(METRICS_PAUSED, "paused") \
+    X(METRICS_LOSE, "lose") \
+    X(METRICS_WIN, "win") \
+    X(METRICS_CLOSE, "close")
+
+# define METRICS_STATE_ENUM(state, name) state,
+
+typedef enum MetricsState {
+    METRICS_STATES(METRICS_STATE_ENUM)
+    METRICS_STATE_COUNT,
+} MetricsState;
+
+# undef METRICS_STATE_ENUM
+
+// The latest values only, overwritten every frame. Times are in seconds.
+typedef struct LiveMetrics {
+    uint64_t frame;
+    double simTime;
+    double fastShotRemaining;
+    double fastMoveRemaining;
+    float fps;
+    float frameTime;
+    float tickTime;
+    float timeScale;
+    uint32_t aliensAlive;
+    uint32_t playerBullets;
+    uint32_t enemyBullets;
+    uint32_t powerups;
+    uint32_t particles;
+    // A MetricsState
+    uint8_t gameState;
+    uint8_t wave;
+    bool fastShotActive;
+    bool fastMoveActive;
+    bool enemyShipActive;
+} LiveMetrics;
+
+// The whole shared segment. sequence is odd while the game is writing, a
+// reader copies the metrics out and keeps the copy only if sequence was the
+// same even number before and after.
+typedef struct MetricsSegment {
+    char magic[4];
+    uint32_t version;
+    uint32_t size;
+    int32_t pid;
+    _Atomic uint32_t sequence;
+    LiveMetrics metrics;
+} MetricsSegment;
+
+// Publishing is two atomic stores and a copy into the mapping, no syscall
+// and nothing a reader can hold up
+typedef struct MetricsPublisher {
+    MetricsSegment *segment;
+    uint64_t frames;
+    char name[64];
+} MetricsPublisher;
+
+MetricsPublisher *openMetricsPublisher(const char *name);
+
+// Numbers the frame, then publishes it
+void publishMetrics(MetricsPublisher *, LiveMetrics *);
+
+// Unlinks the segment, readers still mapping it keep the last values
+void closeMetricsPublisher(MetricsPublisher *);
+
+MetricsSegment *attachMetrics(const char *name);
+
+// False when the game was mid-write on every try, the reader should just
+// come back later
+bool readMetrics(const MetricsSegment *, LiveMetrics *, int attempts);
+
+// False once the game that created the segment has exited. A game that
+// crashed never publishes METRICS_CLOSE, this is how a reader finds out.
+bool metricsPublisherAlive(const MetricsSegment *);
+
+// "?" for anything past the known states
+const char *metricsStateName(uint8_t state);
+
+void detachMetrics(MetricsSegment *);
+
+# endif
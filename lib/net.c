@@ -0,0 +1,366 @@
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+# include <fcntl.h>
+# include <arpa/inet.h>
+# include <sys/socket.h>
+# include "net.h"
+
+
+static const Snapshot emptySnapshot;
+
+void writeBits(BitWriter *writer, uint32_t value, int bits) {
+    for (int i = 0; i < bits; ++i) {
+        int byte = writer->position >> 3;
+        int shift = writer->position & 7;
+        if (byte >= writer->capacity) {
+            writer->overflow = true;
+            return;
+        }
+
+        if (shift == 0) writer->buffer[byte] = 0;
+        writer->buffer[byte] |= ((value >> i) & 1u) << shift;
+        writer->position++;
+    }
+}
+
+uint32_t readBits(BitReader *reader, int bits) {
+    uint32_t value = 0;
+    for (int i = 0; i < bits; ++i) {
+        int byte = reader->position >> 3;
+        int shift = reader->position & 7;
+        if (byte >= reader->size) {
+            reader->overflow = true;
+            return 0;
+        }
+
+        value |= (uint32_t)((reader->buffer[byte] >> shift) & 1u) << i;
+        reader->position++;
+    }
+
+    return value;
+}
+
+// One bit says whether the field moved since the baseline, the value follows
+// only when it did
+void writeField(BitWriter *writer, uint32_t value, uint32_t baseline, int bits) {
+    if (value == baseline) {
+        writeBits(writer, 0, 1);
+    } else {
+        writeBits(writer, 1, 1);
+        writeBits(writer, value, bits);
+    }
+}
+
+uint32_t readField(BitReader *reader, uint32_t baseline, int bits) {
+    if (readBits(reader, 1)) return readBits(reader, bits);
+    return baseline;
+}
+
+void encodeSnapshot(BitWriter *writer, const Snapshot *snapshot, const Snapshot *baseline) {
+    if (baseline == NULL) baseline = &emptySnapshot;
+
+    writeField(writer, snapshot->hordeX, baseline->hordeX, 16);
+    writeField(writer, snapshot->hordeY, baseline->hordeY, 16);
+    writeField(writer, snapshot->shipX, baseline->shipX, 16);
+    writeField(writer, snapshot->enemyShipX, baseline->enemyShipX, 16);
+    writeField(writer, (uint16_t)snapshot->hordeSpeed, (uint16_t)baseline->hordeSpeed, 16);
+    writeField(writer, snapshot->fastShotTime, baseline->fastShotTime, 10);
+    writeField(writer, snapshot->fastMoveTime, baseline->fastMoveTime, 10);
+    writeField(writer, snapshot->enemyShipAlarm, baseline->enemyShipAlarm, 10);
+    writeField(writer, snapshot->state, baseline->state, 5);
+    writeField(writer, snapshot->wave, baseline->wave, 5);
+    writeField(writer, snapshot->flags, baseline->flags, 6);
+
+    // Aliens only ever die, so the formation is sent as the indices that
+    // flipped since the baseline
+    uint64_t flipped = snapshot->aliveBits ^ baseline->aliveBits;
+    writeBits(writer, __builtin_popcountll(flipped), 7);
+    while (flipped) {
+        writeBits(writer, __builtin_ctzll(flipped), 6);
+        flipped &= flipped - 1;
+    }
+
+    // A projectile keeps its slot, column and kind from snapshot to snapshot,
+    // so most of them only need their vertical travel since the baseline
+    writeBits(writer, snapshot->projectileCount, 9);
+    for (int i = 0; i < snapshot->projectileCount; ++i) {
+        bool matched = i < baseline->projectileCount &&
+            snapshot->projectileX[i] == baseline->projectileX[i] &&
+            snapshot->projectileKind[i] == baseline->projectileKind[i];
+
+        writeBits(writer, matched, 1);
+        if (matched) {
+            int deltaY = (int)snapshot->projectileY[i] - (int)baseline->projectileY[i];
+            if (deltaY >= -512 && deltaY < 512) {
+                writeBits(writer, 1, 1);
+                writeBits(writer, (uint32_t)deltaY & 0x3FFu, 10);
+            } else {
+                writeBits(writer, 0, 1);
+                writeBits(writer, snapshot->projectileY[i], 11);
+            }
+        } else {
+            writeBits(writer, snapshot->projectileKind[i], 2);
+            writeBits(writer, snapshot->projectileX[i], 11);
+            writeBits(writer, snapshot->projectileY[i], 11);
+        }
+    }
+}
+
+bool decodeSnapshot(BitReader *reader, Snapshot *snapshot, const Snapshot *baseline) {
+    if (baseline == NULL) baseline = &emptySnapshot;
+
+    snapshot->hordeX = readField(reader, baseline->hordeX, 16);
+    snapshot->hordeY = readField(reader, baseline->hordeY, 16);
+    snapshot->shipX = readField(reader, baseline->shipX, 16);
+    snapshot->enemyShipX = readField(reader, baseline->enemyShipX, 16);
+    snapshot->hordeSpeed = (int16_t)readField(reader, (uint16_t)baseline->hordeSpeed, 16);
+    snapshot->fastShotTime = readField(reader, baseline->fastShotTime, 10);
+    snapshot->fastMoveTime = readField(reader, baseline->fastMoveTime, 10);
+    snapshot->enemyShipAlarm = readField(reader, baseline->enemyShipAlarm, 10);
+    snapshot->state = readField(reader, baseline->state, 5);
+    snapshot->wave = readField(reader, baseline->wave, 5);
+    snapshot->flags = readField(reader, baseline->flags, 6);
+
+    snapshot->aliveBits = baseline->aliveBits;
+    int flipped = readBits(reader, 7);
+    for (int i = 0; i < flipped; ++i) {
+        snapshot->aliveBits ^= 1ull << readBits(reader, 6);
+    }
+
+    snapshot->projectileCount = readBits(reader, 9);
+    if (snapshot->projectileCount > NET_MAX_PROJECTILES) return false;
+    for (int i = 0; i < snapshot->projectileCount; ++i) {
+        bool matched = readBits(reader, 1);
+        if (matched && i < baseline->projectileCount) {
+            snapshot->projectileKind[i] = baseline->projectileKind[i];
+            snapshot->projectileX[i] = baseline->projectileX[i];
+            if (readBits(reader, 1)) {
+                int deltaY = (int)readBits(reader, 10);
+                if (deltaY & 0x200) deltaY -= 0x400;
+                snapshot->projectileY[i] = (uint16_t)(baseline->projectileY[i] + deltaY);
+            } else {
+                snapshot->projectileY[i] = readBits(reader, 11);
+            }
+        } else if (matched) {
+            return false;
+        } else {
+            snapshot->projectileKind[i] = readBits(reader, 2);
+            snapshot->projectileX[i] = readBits(reader, 11);
+            snapshot->projectileY[i] = readBits(reader, 11);
+        }
+    }
+
+    return !reader->overflow;
+}
+
+NetLink *openNetLink(int port, float lossRate, double latency) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) return NULL;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(fd);
+        return NULL;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    NetLink *link = (NetLink *)malloc(sizeof(NetLink));
+    link->socket = fd;
+    link->queued = 0;
+    link->hasPeer = false;
+    link->lossRate = lossRate;
+    link->latency = latency;
+    link->overflows = 0;
+    // The shim has its own generator so dropping packets never shifts the game's rolls
+    link->shimState = 0x9E3779B9u ^ (uint32_t)port;
+
+    return link;
+}
+
+bool connectNetLink(NetLink *link, const char *address, int port) {
+    memset(&link->peer, 0, sizeof(link->peer));
+    link->peer.sin_family = AF_INET;
+    link->peer.sin_port = htons(port);
+    link->hasPeer = inet_pton(AF_INET, address, &link->peer.sin_addr) == 1;
+    return link->hasPeer;
+}
+
+uint32_t nextShimRandom(NetLink *link) {
+    link->shimState ^= link->shimState << 13;
+    link->shimState ^= link->shimState >> 17;
+    link->shimState ^= link->shimState << 5;
+    return link->shimState;
+}
+
+void transmit(NetLink *link, const uint8_t *data, int size) {
+    sendto(link->socket, data, size, 0, (struct sockaddr *)&link->peer, sizeof(link->peer));
+}
+
+void sendPacket(NetLink *link, const uint8_t *data, int size, double now) {
+    if (!link->hasPeer || size > NET_PACKET_SIZE) return;
+    if (link->lossRate > 0.0f && (float)(nextShimRandom(link) % 10000) < link->lossRate*10000.0f) return;
+
+    if (link->latency <= 0.0) {
+        transmit(link, data, size);
+        return;
+    }
+
+    // Sending it now would overtake everything still queued, a saturated
+    // link loses packets instead
+    if (link->queued == NET_QUEUE_CAPACITY) {
+        link->overflows++;
+        return;
+    }
+    DelayedPacket *packet = &link->queue[link->queued++];
+    memcpy(packet->data, data, size);
+    packet->size = size;
+    packet->deliverAt = now + link->latency;
+}
+
+int receivePacket(NetLink *link, uint8_t *buffer, int capacity) {
+    struct sockaddr_in from;
+    socklen_t fromSize = sizeof(from);
+    ssize_t size = recvfrom(link->socket, buffer, capacity, 0, (struct sockaddr *)&from, &fromSize);
+    if (size <= 0) return 0;
+
+    // The host answers whoever spoke to it first
+    if (!link->hasPeer) {
+        link->peer = from;
+        link->hasPeer = true;
+    }
+
+    return (int)size;
+}
+
+void pumpNetLink(NetLink *link, double now) {
+    int kept = 0;
+    for (int i = 0; i < link->queued; ++i) {
+        if (link->queue[i].deliverAt <= now) {
+            transmit(link, link->queue[i].data, link->queue[i].size);
+        } else {
+            if (kept != i) link->queue[kept] = link->queue[i];
+            kept++;
+        }
+    }
+    link->queued = kept;
+}
+
+void closeNetLink(NetLink *link) {
+    close(link->socket);
+    free(link);
+}
+
+NetSession *openNetSession(NetRole role, const char *address, int port, float lossRate, double latency) {
+    NetLink *link = openNetLink(role == NET_HOST ? port : 0, lossRate, latency);
+    if (link == NULL) return NULL;
+    if (role == NET_SPECTATOR && !connectNetLink(link, address, port)) {
+        closeNetLink(link);
+        return NULL;
+    }
+
+    NetSession *session = (NetSession *)malloc(sizeof(NetSession));
+    session->link = link;
+    session->history = (Snapshot *)calloc(NET_HISTORY, sizeof(Snapshot));
+    session->role = role;
+    session->tick = 0;
+    session->ackedTick = 0;
+    session->latestTick = 0;
+    session->truncatedSnapshots = 0;
+
+    return session;
+}
+
+Snapshot *nextSnapshot(NetSession *session) {
+    session->tick++;
+    Snapshot *snapshot = &session->history[session->tick % NET_HISTORY];
+    snapshot->tick = session->tick;
+    return snapshot;
+}
+
+void sendSnapshot(NetSession *session, double now) {
+    uint8_t packet[NET_PACKET_SIZE];
+    int size;
+
+    while ((size = receivePacket(session->link, packet, sizeof(packet))) > 0) {
+        BitReader reader = {.buffer=packet, .size=size};
+        if (readBits(&reader, 2) != PACKET_ACK) continue;
+
+        uint32_t tick = readBits(&reader, 32);
+        if (!reader.overflow && tick > session->ackedTick && tick <= session->tick) {
+            session->ackedTick = tick;
+        }
+    }
+
+    // Deltas are always taken against something the peer is known to hold,
+    // a lost packet just means the next one is a little bigger
+    const Snapshot *baseline = NULL;
+    uint32_t baselineTick = 0;
+    if (session->ackedTick != 0 && session->tick - session->ackedTick < NET_HISTORY) {
+        baselineTick = session->ackedTick;
+        baseline = &session->history[baselineTick % NET_HISTORY];
+    }
+
+    BitWriter writer = {.buffer=packet, .capacity=sizeof(packet)};
+    writeBits(&writer, PACKET_SNAPSHOT, 2);
+    writeBits(&writer, session->tick, 32);
+    writeBits(&writer, baselineTick, 32);
+    encodeSnapshot(&writer, &session->history[session->tick % NET_HISTORY], baseline);
+    if (!writer.overflow) {
+        sendPacket(session->link, packet, (writer.position + 7)/8, now);
+    }
+
+    pumpNetLink(session->link, now);
+}
+
+const Snapshot *receiveSnapshot(NetSession *session, double now) {
+    uint8_t packet[NET_PACKET_SIZE];
+    const Snapshot *latest = NULL;
+    Snapshot decoded;
+    int size;
+
+    if (session->latestTick == 0) {
+        BitWriter writer = {.buffer=packet, .capacity=sizeof(packet)};
+        writeBits(&writer, PACKET_HELLO, 2);
+        sendPacket(session->link, packet, 1, now);
+    }
+
+    while ((size = receivePacket(session->link, packet, sizeof(packet))) > 0) {
+        BitReader reader = {.buffer=packet, .size=size};
+        if (readBits(&reader, 2) != PACKET_SNAPSHOT) continue;
+
+        uint32_t tick = readBits(&reader, 32);
+        uint32_t baselineTick = readBits(&reader, 32);
+        if (reader.overflow || tick <= session->latestTick) continue;
+
+        const Snapshot *baseline = NULL;
+        if (baselineTick != 0) {
+            baseline = &session->history[baselineTick % NET_HISTORY];
+            if (baseline->tick != baselineTick) continue;
+        }
+        if (!decodeSnapshot(&reader, &decoded, baseline)) continue;
+
+        decoded.tick = tick;
+        session->history[tick % NET_HISTORY] = decoded;
+        session->latestTick = tick;
+        latest = &session->history[tick % NET_HISTORY];
+
+        BitWriter writer = {.buffer=packet, .capacity=sizeof(packet)};
+        writeBits(&writer, PACKET_ACK, 2);
+        writeBits(&writer, tick, 32);
+        sendPacket(session->link, packet, (writer.position + 7)/8, now);
+    }
+
+    pumpNetLink(session->link, now);
+    return latest;
+}
+
+void closeNetSession(NetSession *session) {
+    closeNetLink(session->link);
+    free(session->history);
+    free(session);
+}
@@ -0,0 +1,125 @@
+# ifndef _NET_H_
+# define _NET_H_
+
+# include <stdbool.h>
+# include <stdint.h>
+# include <netinet/in.h>
+
+# define NET_MAX_PROJECTILES 256
+# define NET_HISTORY 64
+# define NET_PACKET_SIZE 1200
+# define NET_QUEUE_CAPACITY 256
+# define NET_DEFAULT_PORT 27960
+
+typedef enum NetRole {
+    NET_OFF,
+    NET_HOST,
+    NET_SPECTATOR,
+} NetRole;
+
+typedef enum PacketType {
+    PACKET_HELLO,
+    PACKET_SNAPSHOT,
+    PACKET_ACK,
+} PacketType;
+
+// Everything a remote view needs, already quantized to what goes on the wire.
+// The host publishes one per frame, tick counts them.
+typedef struct Snapshot {
+    uint64_t aliveBits;
+    uint32_t tick;
+    uint16_t hordeX;
+    uint16_t hordeY;
+    uint16_t shipX;
+    uint16_t enemyShipX;
+    int16_t hordeSpeed;
+    uint16_t fastShotTime;
+    uint16_t fastMoveTime;
+    uint16_t enemyShipAlarm;
+    uint8_t state;
+    uint8_t wave;
+    uint8_t flags;
+    uint16_t projectileCount;
+    uint16_t projectileX[NET_MAX_PROJECTILES];
+    uint16_t projectileY[NET_MAX_PROJECTILES];
+    // Index into the game's projectile kind table, two bits on the wire
+    uint8_t projectileKind[NET_MAX_PROJECTILES];
+} Snapshot;
+
+typedef struct BitWriter {
+    uint8_t *buffer;
+    int capacity;
+    int position;
+    bool overflow;
+} BitWriter;
+
+typedef struct BitReader {
+    const uint8_t *buffer;
+    int size;
+    int position;
+    bool overflow;
+} BitReader;
+
+typedef struct DelayedPacket {
+    uint8_t data[NET_PACKET_SIZE];
+    double deliverAt;
+    int size;
+} DelayedPacket;
+
+// A UDP socket with an optional loss and latency shim on the sending side,
+// so two instances on loopback behave like a bad connection
+typedef struct NetLink {
+    DelayedPacket queue[NET_QUEUE_CAPACITY];
+    struct sockaddr_in peer;
+    int socket;
+    int queued;
+    bool hasPeer;
+    float lossRate;
+    double latency;
+    uint32_t shimState;
+    // Packets dropped because the delay queue was full
+    uint32_t overflows;
+} NetLink;
+
+typedef struct NetSession {
+    NetLink *link;
+    Snapshot *history;
+    NetRole role;
+    uint32_t tick;
+    uint32_t ackedTick;
+    uint32_t latestTick;
+    // Snapshots that had more projectiles than they hold
+    uint32_t truncatedSnapshots;
+} NetSession;
+
+void writeBits(BitWriter *, uint32_t value, int bits);
+
+uint32_t readBits(BitReader *, int bits);
+
+void encodeSnapshot(BitWriter *, const Snapshot *, const Snapshot *baseline);
+
+bool decodeSnapshot(BitReader *, Snapshot *, const Snapshot *baseline);
+
+NetLink *openNetLink(int port, float lossRate, double latency);
+
+bool connectNetLink(NetLink *, const char *address, int port);
+
+void sendPacket(NetLink *, const uint8_t *data, int size, double now);
+
+int receivePacket(NetLink *, uint8_t *buffer, int capacity);
+
+void pumpNetLink(NetLink *, double now);
+
+void closeNetLink(NetLink *);
+
+NetSession *openNetSession(NetRole, const char *address, int port, float lossRate, double latency);
+
+Snapshot *nextSnapshot(NetSession *);
+
+void sendSnapshot(NetSession *, double now);
+
+const Snapshot *receiveSnapshot(NetSession *, double now);
+
+void closeNetSession(NetSession *);
+
+# endif
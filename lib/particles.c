@@ -0,0 +1,109 @@
+# include <stdlib.h>
+# include <math.h>
+# include "particles.h"
+# include "raylib.h"
+
+
+ParticleSystem *createParticleSystem() {
+    const int capacity = PARTICLES_CAPACITY;
+
+    ParticleSystem *particles = (ParticleSystem *)malloc(sizeof(ParticleSystem));
+    particles->x = (float *)malloc(capacity*sizeof(float));
+    particles->y = (float *)malloc(capacity*sizeof(float));
+    particles->velocityX = (float *)malloc(capacity*sizeof(float));
+    particles->velocityY = (float *)malloc(capacity*sizeof(float));
+    particles->life = (float *)malloc(capacity*sizeof(float));
+    particles->color = (Color *)malloc(capacity*sizeof(Color));
+    particles->count = 0;
+    particles->capacity = capacity;
+    particles->lifetime = 0.6f;
+    particles->size = 3.0f;
+    particles->drag = 2.5f;
+    seedRandom(&particles->random, 0);
+
+    return particles;
+}
+
+void spawnExplosion(ParticleSystem *particles, float x, float y, int amount, float speed, Color color) {
+    // When the pool is full the burst is clipped, never reallocated
+    if (amount > particles->capacity - particles->count) {
+        amount = particles->capacity - particles->count;
+    }
+
+    int first = particles->count;
+    for (int i = first; i < first + amount; ++i) {
+        float angle = (float)randomBelow(&particles->random, 6283) / 1000.0f;
+        float magnitude = speed*(0.25f + (float)randomBelow(&particles->random, 750) / 1000.0f);
+
+        particles->x[i] = x;
+        particles->y[i] = y;
+        particles->velocityX[i] = cosf(angle)*magnitude;
+        particles->velocityY[i] = sinf(angle)*magnitude;
+        particles->life[i] = particles->lifetime*(0.5f + (float)randomBelow(&particles->random, 500) / 1000.0f);
+        particles->color[i] = color;
+    }
+    particles->count += amount;
+}
+
+void updateParticles(ParticleSystem *particles, float delta) {
+    float *restrict x = particles->x;
+    float *restrict y = particles->y;
+    float *restrict velocityX = particles->velocityX;
+    float *restrict velocityY = particles->velocityY;
+    float *restrict life = particles->life;
+    Color *restrict color = particles->color;
+    const int count = particles->count;
+    float damping = 1.0f - particles->drag*delta;
+    if (damping < 0.0f) damping = 0.0f;
+
+    // Straight-line integration, no branches so the compiler emits SIMD
+    for (int i = 0; i < count; ++i) {
+        x[i] += velocityX[i]*delta;
+        y[i] += velocityY[i]*delta;
+        velocityX[i] *= damping;
+        velocityY[i] *= damping;
+        life[i] -= delta;
+    }
+
+    // Lifetime culling as a single stream compaction: every slot is copied
+    // down unconditionally and the write cursor only advances for survivors
+    int alive = 0;
+    for (int i = 0; i < count; ++i) {
+        x[alive] = x[i];
+        y[alive] = y[i];
+        velocityX[alive] = velocityX[i];
+        velocityY[alive] = velocityY[i];
+        life[alive] = life[i];
+        color[alive] = color[i];
+        alive += life[i] > 0.0f;
+    }
+    particles->count = alive;
+}
+
+void drawParticles(ParticleSystem *particles, RenderBackend *renderer) {
+    // Shapes share raylib's default texture, so consecutive rectangles are
+    // merged into one batch and flushed with a single draw call
+    const float size = particles->size;
+    const float inverseLifetime = 1.0f/particles->lifetime;
+
+    for (int i = 0; i < particles->count; ++i) {
+        Color color = particles->color[i];
+        float fade = particles->life[i]*inverseLifetime;
+        color.a = (unsigned char)(color.a*(fade > 1.0f ? 1.0f : fade));
+        renderer->rectangle(
+            renderer,
+            (Rectangle){.height=size, .width=size, .x=particles->x[i], .y=particles->y[i]},
+            color
+        );
+    }
+}
+
+void freeParticleSystem(ParticleSystem *particles) {
+    free(particles->x);
+    free(particles->y);
+    free(particles->velocityX);
+    free(particles->velocityY);
+    free(particles->life);
+    free(particles->color);
+    free(particles);
+}
@@ -0,0 +1,39 @@
+# ifndef _PARTICLES_H_
+# define _PARTICLES_H_
+
+# include <stdlib.h>
+# include "render.h"
+# include "random.h"
+# include "raylib.h"
+
+# define PARTICLES_CAPACITY 65536
+
+// Structure of arrays: every hot loop streams through the fields it needs
+// and nothing else, so the integration passes vectorize.
+typedef struct ParticleSystem {
+    float *x;
+    float *y;
+    float *velocityX;
+    float *velocityY;
+    float *life;
+    Color *color;
+    int count;
+    int capacity;
+    float lifetime;
+    float size;
+    float drag;
+    // Apart from the simulation's, so bursts never shift its rolls
+    GameRandom random;
+} ParticleSystem;
+
+ParticleSystem *createParticleSystem();
+
+void spawnExplosion(ParticleSystem *, float x, float y, int amount, float speed, Color);
+
+void updateParticles(ParticleSystem *, float delta);
+
+void drawParticles(ParticleSystem *, RenderBackend *);
+
+void freeParticleSystem(ParticleSystem *);
+
+# endif
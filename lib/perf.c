@@ -0,0 +1,145 @@
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include <unistd.h>
+# include "perf.h"
+
+# ifdef __linux__
+
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <linux/perf_event.h>
+
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counterEvents[PERF_COUNTER_COUNT] = {
+    [PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    [PERF_INSTRUCTIONS] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    [PERF_L1D_MISSES] = {
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+    },
+    [PERF_LLC_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    [PERF_BRANCH_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int openCounter(PerfCounter counter) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counterEvents[counter].type;
+    attr.config = counterEvents[counter].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// More counters than the PMU has get time sliced, the count is scaled up to
+// the whole time the counter was enabled
+uint64_t readCounter(int file) {
+    uint64_t values[3];
+    if (read(file, values, sizeof(values)) != sizeof(values) || values[2] == 0) return 0;
+    if (values[1] == values[2]) return values[0];
+    return (uint64_t)((double)values[0]*values[1]/values[2]);
+}
+
+PerfHarness *openPerfHarness() {
+    PerfHarness *perf = (PerfHarness *)calloc(1, sizeof(PerfHarness));
+    memset(perf->files, -1, sizeof(perf->files));
+    int opened = 0;
+
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        perf->files[0][counter] = openCounter(counter);
+        opened += perf->files[0][counter] >= 0;
+    }
+    if (opened == 0) {
+        free(perf);
+        return NULL;
+    }
+    markPerfHarness(perf);
+
+    return perf;
+}
+
+// Only the counters the main thread got, so every thread counts the same
+// events
+void openPerfThread(PerfHarness *perf, int thread) {
+    if (thread <= 0 || thread >= PERF_MAX_THREADS) return;
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (perf->files[0][counter] >= 0) perf->files[thread][counter] = openCounter(counter);
+    }
+}
+
+void closePerfHarness(PerfHarness *perf) {
+    for (int thread = 0; thread < PERF_MAX_THREADS; ++thread) {
+        for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+            if (perf->files[thread][counter] >= 0) close(perf->files[thread][counter]);
+        }
+    }
+    free(perf);
+}
+
+# else
+
+PerfHarness *openPerfHarness() {
+    return NULL;
+}
+
+void openPerfThread(PerfHarness *perf, int thread) {
+}
+
+uint64_t readCounter(int file) {
+    return 0;
+}
+
+void closePerfHarness(PerfHarness *perf) {
+    free(perf);
+}
+
+# endif
+
+bool perfCounterAvailable(const PerfHarness *perf, PerfCounter counter) {
+    return perf->files[0][counter] >= 0;
+}
+
+// A worker's counter is read from the main thread, the kernel fetches its
+// count from whichever CPU the worker runs on
+uint64_t readAllThreads(const PerfHarness *perf, PerfCounter counter) {
+    uint64_t total = 0;
+    for (int thread = 0; thread < PERF_MAX_THREADS; ++thread) {
+        if (perf->files[thread][counter] >= 0) total += readCounter(perf->files[thread][counter]);
+    }
+    return total;
+}
+
+void markPerfHarness(PerfHarness *perf) {
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (perfCounterAvailable(perf, counter)) perf->last[counter] = readAllThreads(perf, counter);
+    }
+}
+
+void endPerfPhase(PerfHarness *perf, PerfPhase phase) {
+    for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) {
+        if (!perfCounterAvailable(perf, counter)) continue;
+        uint64_t now = readAllThreads(perf, counter);
+        // Scaled counts are estimates and can come out a little behind
+        perf->totals[phase][counter] += now > perf->last[counter] ? now - perf->last[counter] : 0;
+        perf->last[counter] = now;
+    }
+    perf->samples[phase]++;
+}
+
+void resetPerfHarness(PerfHarness *perf) {
+    memset(perf->totals, 0, sizeof(perf->totals));
+    memset(perf->samples, 0, sizeof(perf->samples));
+}
+
+double perfClock() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec*1e-9;
+}
@@ -0,0 +1,64 @@
+# ifndef _PERF_H_
+# define _PERF_H_
+
+# include <stdint.h>
+# include <stdbool.h>
+
+typedef enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT,
+} PerfCounter;
+
+typedef enum PerfPhase {
+    PERF_COLLISIONS,
+    PERF_SHIP,
+    PERF_HORDE,
+    PERF_ENEMY_SHIP,
+    PERF_PROJECTILES,
+    PERF_PHASE_COUNT,
+} PerfPhase;
+
+// One set of counters for the main thread and one for each job worker
+# define PERF_MAX_THREADS 16
+
+// Hardware counters read at every phase boundary of a step, the difference
+// since the last read is charged to the phase that just ended. Counters are
+// opened for user space only, one set per thread, and a read adds up every
+// thread so the job workers' share of a phase is counted with it. Inherited
+// counters would not do, a child's counts only reach its parent when the
+// child exits. Any counter the CPU or the kernel's perf_event_paranoid
+// setting refuses is left out.
+typedef struct PerfHarness {
+    int files[PERF_MAX_THREADS][PERF_COUNTER_COUNT];
+    uint64_t last[PERF_COUNTER_COUNT];
+    uint64_t totals[PERF_PHASE_COUNT][PERF_COUNTER_COUNT];
+    uint64_t samples[PERF_PHASE_COUNT];
+} PerfHarness;
+
+// Counts the calling thread. NULL when no counter at all could be opened.
+PerfHarness *openPerfHarness();
+
+// Called on a worker thread to count it too, before the next mark. Thread 0
+// is the one that opened the harness.
+void openPerfThread(PerfHarness *, int thread);
+
+bool perfCounterAvailable(const PerfHarness *, PerfCounter);
+
+// Starts a step, nothing is charged for the time since the last phase
+void markPerfHarness(PerfHarness *);
+
+void endPerfPhase(PerfHarness *, PerfPhase);
+
+void resetPerfHarness(PerfHarness *);
+
+void closePerfHarness(PerfHarness *);
+
+// Wall seconds on a monotonic clock for phase and frame times, it runs with
+// or without a window
+double perfClock();
+
+# endif
@@ -0,0 +1,21 @@
+# include "random.h"
+
+
+void seedRandom(GameRandom *random, uint64_t seed) {
+    // A zero state would stay zero forever
+    random->state = seed ? seed : 0x9E3779B97F4A7C15ull;
+}
+
+// xorshift64*, plenty for gameplay rolls and cheap to carry around
+uint32_t nextRandom(GameRandom *random) {
+    uint64_t x = random->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    random->state = x;
+    return (uint32_t)((x*0x2545F4914F6CDD1Dull) >> 32);
+}
+
+int randomBelow(GameRandom *random, int bound) {
+    return (int)(((uint64_t)nextRandom(random)*(uint64_t)bound) >> 32);
+}
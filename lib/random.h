@@ -0,0 +1,18 @@
+# ifndef _RANDOM_H_
+# define _RANDOM_H_
+
+# include <stdint.h>
+
+// The simulation draws only from this, never from rand(), so its whole
+// random state is one word that can be saved, restored and hashed
+typedef struct GameRandom {
+    uint64_t state;
+} GameRandom;
+
+void seedRandom(GameRandom *, uint64_t seed);
+
+uint32_t nextRandom(GameRandom *);
+
+int randomBelow(GameRandom *, int bound);
+
+# endif
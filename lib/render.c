@@ -0,0 +1,259 @@
+# include <stdlib.h>
+# include <string.h>
+# include <limits.h>
+# include "render.h"
+
+
+// Stand-in for the default font's texture, which InitWindow also makes the
+// shapes texture, and for nothing being bound at the start of a frame
+# define SHAPES_TEXTURE (UINT_MAX)
+# define NO_TEXTURE (UINT_MAX - 1)
+
+void raylibClear(RenderBackend *backend, Color color) {
+    (void)backend;
+    ClearBackground(color);
+}
+
+void raylibTexture(RenderBackend *backend, Texture2D texture, Rectangle source, Rectangle dest, Color tint) {
+    (void)backend;
+    DrawTexturePro(texture, source, dest, (Vector2){0.0f, 0.0f}, 0.0f, tint);
+}
+
+void raylibRectangle(RenderBackend *backend, Rectangle rectangle, Color color) {
+    (void)backend;
+    DrawRectangleRec(rectangle, color);
+}
+
+void raylibText(RenderBackend *backend, const char *text, int x, int y, int size, Color color) {
+    (void)backend;
+    DrawText(text, x, y, size, color);
+}
+
+void raylibFps(RenderBackend *backend, int x, int y) {
+    (void)backend;
+    DrawFPS(x, y);
+}
+
+Vector2 raylibMeasureText(RenderBackend *backend, const char *text, float size, float spacing) {
+    (void)backend;
+    return MeasureTextEx(GetFontDefault(), text, size, spacing);
+}
+
+Texture2D raylibLoadTexture(RenderBackend *backend, const char *path) {
+    (void)backend;
+    return LoadTexture(path);
+}
+
+Texture2D raylibCreateTexture(RenderBackend *backend, int width, int height) {
+    (void)backend;
+    Image image = GenImageColor(width, height, BLANK);
+    Texture2D texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    return texture;
+}
+
+void raylibUpdateTexture(RenderBackend *backend, Texture2D texture, const void *pixels) {
+    (void)backend;
+    UpdateTexture(texture, pixels);
+}
+
+void raylibUnloadTexture(RenderBackend *backend, Texture2D texture) {
+    (void)backend;
+    UnloadTexture(texture);
+}
+
+RenderBackend *createRaylibBackend() {
+    RenderBackend *backend = (RenderBackend *)malloc(sizeof(RenderBackend));
+    backend->clear = raylibClear;
+    backend->texture = raylibTexture;
+    backend->rectangle = raylibRectangle;
+    backend->text = raylibText;
+    backend->fps = raylibFps;
+    backend->measureText = raylibMeasureText;
+    backend->loadTexture = raylibLoadTexture;
+    backend->createTexture = raylibCreateTexture;
+    backend->updateTexture = raylibUpdateTexture;
+    backend->unloadTexture = raylibUnloadTexture;
+
+    return backend;
+}
+
+float coveredLength(float start, float length, float limit) {
+    float end = start + length;
+    if (start < 0.0f) start = 0.0f;
+    if (end > limit) end = limit;
+    return end > start ? end - start : 0.0f;
+}
+
+void countQuads(RecordingBackend *recorder, unsigned int texture, uint64_t quads, Rectangle area) {
+    RenderStats *frame = &recorder->frame;
+
+    if (texture != recorder->boundTexture) {
+        if (recorder->boundTexture != NO_TEXTURE) frame->textureSwitches++;
+        frame->drawCalls++;
+        recorder->boundTexture = texture;
+        recorder->batchQuads = 0;
+    }
+    recorder->batchQuads += quads;
+    if (recorder->batchQuads > RENDER_BATCH_QUADS) {
+        frame->drawCalls++;
+        recorder->batchQuads -= RENDER_BATCH_QUADS;
+    }
+    frame->quads += quads;
+    frame->coveredPixels += (uint64_t)(
+        coveredLength(area.x, area.width, recorder->screenWidth)*
+        coveredLength(area.y, area.height, recorder->screenHeight)
+    );
+}
+
+// The backend is the first member, so the callbacks can get back to it
+RecordingBackend *recorderOf(RenderBackend *backend) {
+    return (RecordingBackend *)backend;
+}
+
+void recordClear(RenderBackend *backend, Color color) {
+    RecordingBackend *recorder = recorderOf(backend);
+    if (recorder->inner != NULL) recorder->inner->clear(recorder->inner, color);
+}
+
+void recordTexture(RenderBackend *backend, Texture2D texture, Rectangle source, Rectangle dest, Color tint) {
+    RecordingBackend *recorder = recorderOf(backend);
+    countQuads(recorder, texture.id, 1, dest);
+    if (recorder->inner != NULL) recorder->inner->texture(recorder->inner, texture, source, dest, tint);
+}
+
+void recordRectangle(RenderBackend *backend, Rectangle rectangle, Color color) {
+    RecordingBackend *recorder = recorderOf(backend);
+    countQuads(recorder, SHAPES_TEXTURE, 1, rectangle);
+    if (recorder->inner != NULL) recorder->inner->rectangle(recorder->inner, rectangle, color);
+}
+
+// Spaces advance the pen without a quad
+void countText(RecordingBackend *recorder, const char *text, int x, int y, int size) {
+    uint64_t glyphs = 0;
+    for (const char *c = text; *c != '\0'; ++c) glyphs += *c != ' ' && *c != '\n';
+    if (glyphs == 0) return;
+
+    Rectangle area = {.height=(float)size, .width=glyphs*size/2.0f, .x=(float)x, .y=(float)y};
+    countQuads(recorder, SHAPES_TEXTURE, glyphs, area);
+    recorder->frame.glyphs += glyphs;
+}
+
+void recordText(RenderBackend *backend, const char *text, int x, int y, int size, Color color) {
+    RecordingBackend *recorder = recorderOf(backend);
+    countText(recorder, text, x, y, size);
+    if (recorder->inner != NULL) recorder->inner->text(recorder->inner, text, x, y, size, color);
+}
+
+// DrawFPS prints something like "60 FPS" at size 20
+void recordFps(RenderBackend *backend, int x, int y) {
+    RecordingBackend *recorder = recorderOf(backend);
+    countText(recorder, "60 FPS", x, y, 20);
+    if (recorder->inner != NULL) recorder->inner->fps(recorder->inner, x, y);
+}
+
+// Every character advances the pen by the half square text is counted at
+Vector2 recordMeasureText(RenderBackend *backend, const char *text, float size, float spacing) {
+    RecordingBackend *recorder = recorderOf(backend);
+    if (recorder->inner != NULL) return recorder->inner->measureText(recorder->inner, text, size, spacing);
+
+    int length = (int)strlen(text);
+    float width = length > 0 ? length*size/2.0f + (length - 1)*spacing : 0.0f;
+    return (Vector2){width, size};
+}
+
+// Only the size is read, from the file on the CPU, so sources and layouts
+// come out as they would with the real texture
+Texture2D recordLoadTexture(RenderBackend *backend, const char *path) {
+    RecordingBackend *recorder = recorderOf(backend);
+    if (recorder->inner != NULL) return recorder->inner->loadTexture(recorder->inner, path);
+
+    Image image = LoadImage(path);
+    Texture2D texture = {
+        .id=recorder->nextTexture++,
+        .width=image.width,
+        .height=image.height,
+        .mipmaps=1,
+        .format=image.format,
+    };
+    UnloadImage(image);
+    return texture;
+}
+
+Texture2D recordCreateTexture(RenderBackend *backend, int width, int height) {
+    RecordingBackend *recorder = recorderOf(backend);
+    if (recorder->inner != NULL) return recorder->inner->createTexture(recorder->inner, width, height);
+
+    return (Texture2D){
+        .id=recorder->nextTexture++,
+        .width=width,
+        .height=height,
+        .mipmaps=1,
+        .format=PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+}
+
+void recordUpdateTexture(RenderBackend *backend, Texture2D texture, const void *pixels) {
+    RecordingBackend *recorder = recorderOf(backend);
+    if (recorder->inner != NULL) recorder->inner->updateTexture(recorder->inner, texture, pixels);
+}
+
+void recordUnloadTexture(RenderBackend *backend, Texture2D texture) {
+    RecordingBackend *recorder = recorderOf(backend);
+    if (recorder->inner != NULL) recorder->inner->unloadTexture(recorder->inner, texture);
+}
+
+RecordingBackend *createRecordingBackend(RenderBackend *inner, float screenWidth, float screenHeight) {
+    RecordingBackend *recorder = (RecordingBackend *)calloc(1, sizeof(RecordingBackend));
+    recorder->base.clear = recordClear;
+    recorder->base.texture = recordTexture;
+    recorder->base.rectangle = recordRectangle;
+    recorder->base.text = recordText;
+    recorder->base.fps = recordFps;
+    recorder->base.measureText = recordMeasureText;
+    recorder->base.loadTexture = recordLoadTexture;
+    recorder->base.createTexture = recordCreateTexture;
+    recorder->base.updateTexture = recordUpdateTexture;
+    recorder->base.unloadTexture = recordUnloadTexture;
+    recorder->inner = inner;
+    recorder->boundTexture = NO_TEXTURE;
+    recorder->nextTexture = 1;
+    recorder->screenWidth = screenWidth;
+    recorder->screenHeight = screenHeight;
+
+    return recorder;
+}
+
+uint64_t peakOf(uint64_t peak, uint64_t value) {
+    return value > peak ? value : peak;
+}
+
+RenderStats endRecordedFrame(RecordingBackend *recorder) {
+    RenderStats frame = recorder->frame;
+    RenderStats *total = &recorder->total;
+    RenderStats *peak = &recorder->peak;
+
+    total->drawCalls += frame.drawCalls;
+    total->textureSwitches += frame.textureSwitches;
+    total->quads += frame.quads;
+    total->glyphs += frame.glyphs;
+    total->coveredPixels += frame.coveredPixels;
+    peak->drawCalls = peakOf(peak->drawCalls, frame.drawCalls);
+    peak->textureSwitches = peakOf(peak->textureSwitches, frame.textureSwitches);
+    peak->quads = peakOf(peak->quads, frame.quads);
+    peak->glyphs = peakOf(peak->glyphs, frame.glyphs);
+    peak->coveredPixels = peakOf(peak->coveredPixels, frame.coveredPixels);
+    recorder->frames++;
+
+    // raylib flushes at the end of every frame, so the next one starts with
+    // nothing bound
+    recorder->frame = (RenderStats){.drawCalls=0};
+    recorder->boundTexture = NO_TEXTURE;
+    recorder->batchQuads = 0;
+
+    return frame;
+}
+
+void freeRenderBackend(RenderBackend *backend) {
+    free(backend);
+}
@@ -0,0 +1,86 @@
+# ifndef _RENDER_H_
+# define _RENDER_H_
+
+# include <stdint.h>
+# include <stdbool.h>
+# include "raylib.h"
+
+// raylib starts a new batch past this many quads even on the same texture
+# define RENDER_BATCH_QUADS 8192
+
+typedef enum RenderMode {
+    // Straight to raylib
+    RENDER_DIRECT,
+    // Counted, then drawn
+    RENDER_COUNTED,
+    // Counted only, with no window, GPU or audio device behind it
+    RENDER_HEADLESS,
+} RenderMode;
+
+// Every drawing call the game makes goes through one of these, and so does
+// everything that needs the GPU or the font, so a headless run never has to
+// open a window. Sources and destinations are never rotated and always have
+// their origin at the top left corner, which is all the game uses.
+typedef struct RenderBackend RenderBackend;
+struct RenderBackend {
+    void (*clear)(RenderBackend *, Color);
+    void (*texture)(RenderBackend *, Texture2D, Rectangle source, Rectangle dest, Color);
+    void (*rectangle)(RenderBackend *, Rectangle, Color);
+    void (*text)(RenderBackend *, const char *text, int x, int y, int size, Color);
+    void (*fps)(RenderBackend *, int x, int y);
+    Vector2 (*measureText)(RenderBackend *, const char *text, float size, float spacing);
+    Texture2D (*loadTexture)(RenderBackend *, const char *path);
+    // Blank RGBA texture for pixels the game fills in itself
+    Texture2D (*createTexture)(RenderBackend *, int width, int height);
+    void (*updateTexture)(RenderBackend *, Texture2D, const void *pixels);
+    void (*unloadTexture)(RenderBackend *, Texture2D);
+};
+
+// What one frame asked of the GPU. Draw calls follow raylib's batching, a
+// batch ends on a texture switch or once it is full. Shapes are drawn with
+// the default font's texture, so they batch with text. Covered pixels count
+// every pixel each quad touches on screen, so over the screen size they
+// give the overdraw. Text is estimated at a half square per glyph.
+typedef struct RenderStats {
+    uint64_t drawCalls;
+    uint64_t textureSwitches;
+    uint64_t quads;
+    uint64_t glyphs;
+    uint64_t coveredPixels;
+} RenderStats;
+
+// Per-frame limits a counted run is held to, checked against its worst
+// frame. A zero limit is not checked.
+typedef struct RenderBudget {
+    uint64_t drawCalls;
+    uint64_t textureSwitches;
+    uint64_t quads;
+    float overdraw;
+} RenderBudget;
+
+typedef struct RecordingBackend {
+    RenderBackend base;
+    // Where the calls go on to once counted, NULL drops them and hands out
+    // texture ids that stand for nothing
+    RenderBackend *inner;
+    RenderStats frame;
+    RenderStats total;
+    RenderStats peak;
+    uint64_t frames;
+    unsigned int boundTexture;
+    unsigned int nextTexture;
+    uint64_t batchQuads;
+    float screenWidth;
+    float screenHeight;
+} RecordingBackend;
+
+RenderBackend *createRaylibBackend();
+
+RecordingBackend *createRecordingBackend(RenderBackend *inner, float screenWidth, float screenHeight);
+
+// Closes the frame being counted, adds it to the totals and hands it back
+RenderStats endRecordedFrame(RecordingBackend *);
+
+void freeRenderBackend(RenderBackend *);
+
+# endif
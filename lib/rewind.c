@@ -0,0 +1,199 @@
+# include <stdlib.h>
+# include <string.h>
+# include "rewind.h"
+
+
+RewindBuffer *createRewindBuffer(int budget, int frameCapacity) {
+    RewindBuffer *rewind = (RewindBuffer *)malloc(sizeof(RewindBuffer));
+    // Worst case a literal costs a 4 byte header for every byte that follows
+    // a short matching stretch, twice the frame is a safe bound
+    const int scratchSize = 2*frameCapacity + 16;
+
+    if (budget < 4*scratchSize) budget = 4*scratchSize;
+    rewind->arena = (uint8_t *)malloc(budget);
+    rewind->entries = (RewindEntry *)malloc(REWIND_MAX_ENTRIES*sizeof(RewindEntry));
+    rewind->keyframe = (uint8_t *)malloc(frameCapacity);
+    rewind->scratch = (uint8_t *)malloc(scratchSize);
+    rewind->arenaSize = budget;
+    rewind->frameCapacity = frameCapacity;
+    rewind->first = 0;
+    rewind->count = 0;
+    rewind->keyframeSize = 0;
+    rewind->keyframeTick = 0;
+    rewind->tick = 0;
+
+    return rewind;
+}
+
+RewindEntry *rewindEntry(RewindBuffer *rewind, int index) {
+    return &rewind->entries[(rewind->first + index) % REWIND_MAX_ENTRIES];
+}
+
+uint8_t referenceByte(const uint8_t *reference, int referenceSize, int index) {
+    return index < referenceSize ? reference[index] : 0;
+}
+
+void writeRun(uint8_t *out, int run) {
+    out[0] = run & 0xFF;
+    out[1] = run >> 8;
+}
+
+int readRun(const uint8_t *in) {
+    return in[0] | in[1] << 8;
+}
+
+// Output is a list of (matching run, literal run, literal bytes) records,
+// literals are stored XORed with the reference
+int encodeXor(const uint8_t *frame, int size, const uint8_t *reference, int referenceSize, uint8_t *out) {
+    int written = 0;
+    int i = 0;
+
+    while (i < size) {
+        int matchStart = i;
+        while (i < size && i - matchStart < 65535 && frame[i] == referenceByte(reference, referenceSize, i)) ++i;
+        int matchRun = i - matchStart;
+
+        // Short matching stretches are cheaper inside the literal than as a
+        // record of their own
+        int literalStart = i;
+        while (i < size && i - literalStart < 65535) {
+            if (frame[i] == referenceByte(reference, referenceSize, i)) {
+                int j = i;
+                while (j < size && j - i < 4 && frame[j] == referenceByte(reference, referenceSize, j)) ++j;
+                if (j - i == 4 || j == size || j - literalStart > 65535) break;
+                i = j;
+            } else {
+                ++i;
+            }
+        }
+        int literalRun = i - literalStart;
+
+        writeRun(&out[written], matchRun);
+        writeRun(&out[written + 2], literalRun);
+        written += 4;
+        for (int k = literalStart; k < i; ++k) {
+            out[written++] = frame[k] ^ referenceByte(reference, referenceSize, k);
+        }
+    }
+
+    return written;
+}
+
+void applyXor(const uint8_t *in, int size, uint8_t *frame) {
+    int position = 0;
+    int consumed = 0;
+
+    while (consumed < size) {
+        position += readRun(&in[consumed]);
+        int literalRun = readRun(&in[consumed + 2]);
+        consumed += 4;
+        for (int k = 0; k < literalRun; ++k) {
+            frame[position++] ^= in[consumed++];
+        }
+    }
+}
+
+void evictRewindSegment(RewindBuffer *rewind) {
+    // A delta is useless without its keyframe, so the whole run goes at once
+    do {
+        if (rewindEntry(rewind, 0)->tick == rewind->keyframeTick) rewind->keyframeSize = 0;
+        rewind->first = (rewind->first + 1) % REWIND_MAX_ENTRIES;
+        rewind->count--;
+    } while (rewind->count > 0 && !rewindEntry(rewind, 0)->keyframe);
+}
+
+int reserveRewind(RewindBuffer *rewind, int size) {
+    while (rewind->count > 0) {
+        RewindEntry *oldest = rewindEntry(rewind, 0);
+        RewindEntry *newest = rewindEntry(rewind, rewind->count - 1);
+        int tail = oldest->offset;
+        int head = newest->offset + newest->size;
+
+        if (rewind->count < REWIND_MAX_ENTRIES) {
+            if (newest->offset >= oldest->offset) {
+                if (head + size <= rewind->arenaSize) return head;
+                if (size <= tail) return 0;
+            } else if (head + size <= tail) {
+                return head;
+            }
+        }
+        evictRewindSegment(rewind);
+    }
+
+    return 0;
+}
+
+void recordRewindFrame(RewindBuffer *rewind, const uint8_t *frame, int size, uint64_t hash) {
+    bool keyframe = rewind->keyframeSize == 0 || rewind->tick - rewind->keyframeTick >= REWIND_KEYFRAME_INTERVAL;
+    int encodedSize;
+    int offset;
+
+    if (!keyframe) {
+        encodedSize = encodeXor(frame, size, rewind->keyframe, rewind->keyframeSize, rewind->scratch);
+        offset = reserveRewind(rewind, encodedSize);
+        // Making room may have pushed out the keyframe this delta refers to
+        keyframe = rewind->keyframeSize == 0;
+    }
+    if (keyframe) {
+        encodedSize = encodeXor(frame, size, NULL, 0, rewind->scratch);
+        offset = reserveRewind(rewind, encodedSize);
+        memcpy(rewind->keyframe, frame, size);
+        rewind->keyframeSize = size;
+        rewind->keyframeTick = rewind->tick;
+    }
+
+    memcpy(&rewind->arena[offset], rewind->scratch, encodedSize);
+    RewindEntry *entry = rewindEntry(rewind, rewind->count++);
+    entry->tick = rewind->tick++;
+    entry->offset = offset;
+    entry->size = encodedSize;
+    entry->rawSize = size;
+    entry->keyframe = keyframe;
+    entry->hash = hash;
+}
+
+bool hasRewindFrame(RewindBuffer *rewind, uint32_t tick) {
+    return rewind->count > 0 &&
+        tick >= rewindEntry(rewind, 0)->tick &&
+        tick - rewindEntry(rewind, 0)->tick < (uint32_t)rewind->count;
+}
+
+// The state hash taken when the tick was recorded, 0 when it is gone
+uint64_t rewindFrameHash(RewindBuffer *rewind, uint32_t tick) {
+    if (!hasRewindFrame(rewind, tick)) return 0;
+    return rewindEntry(rewind, tick - rewindEntry(rewind, 0)->tick)->hash;
+}
+
+int restoreRewindFrame(RewindBuffer *rewind, uint32_t tick, uint8_t *frame) {
+    if (!hasRewindFrame(rewind, tick)) return -1;
+
+    int index = tick - rewindEntry(rewind, 0)->tick;
+    int keyIndex = index;
+    while (keyIndex > 0 && !rewindEntry(rewind, keyIndex)->keyframe) --keyIndex;
+
+    RewindEntry *entry = rewindEntry(rewind, index);
+    RewindEntry *key = rewindEntry(rewind, keyIndex);
+    if (!key->keyframe) return -1;
+
+    memset(frame, 0, key->rawSize > entry->rawSize ? key->rawSize : entry->rawSize);
+    applyXor(&rewind->arena[key->offset], key->size, frame);
+    if (entry != key) applyXor(&rewind->arena[entry->offset], entry->size, frame);
+
+    return entry->rawSize;
+}
+
+void truncateRewind(RewindBuffer *rewind, uint32_t tick) {
+    while (rewind->count > 0 && rewindEntry(rewind, rewind->count - 1)->tick > tick) {
+        rewind->count--;
+    }
+    if (rewind->keyframeTick > tick) rewind->keyframeSize = 0;
+    rewind->tick = tick + 1;
+}
+
+void freeRewindBuffer(RewindBuffer *rewind) {
+    free(rewind->arena);
+    free(rewind->entries);
+    free(rewind->keyframe);
+    free(rewind->scratch);
+    free(rewind);
+}
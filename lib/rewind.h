@@ -0,0 +1,53 @@
+# ifndef _REWIND_H_
+# define _REWIND_H_
+
+# include <stdbool.h>
+# include <stdint.h>
+
+# define REWIND_BUDGET (8*1024*1024)
+# define REWIND_MAX_ENTRIES 16384
+# define REWIND_KEYFRAME_INTERVAL 120
+
+typedef struct RewindEntry {
+    uint64_t hash;
+    uint32_t tick;
+    int offset;
+    int size;
+    int rawSize;
+    bool keyframe;
+} RewindEntry;
+
+// Recent history in a fixed budget. The game records once per simulated
+// frame, however many steps it ran, and a tick here counts those records.
+// Each one is stored as the XOR of its frame against the latest keyframe,
+// run-length encoded, so a frame that barely changed costs a few bytes and
+// any frame restores from two records.
+typedef struct RewindBuffer {
+    uint8_t *arena;
+    RewindEntry *entries;
+    uint8_t *keyframe;
+    uint8_t *scratch;
+    int arenaSize;
+    int frameCapacity;
+    int first;
+    int count;
+    int keyframeSize;
+    uint32_t keyframeTick;
+    uint32_t tick;
+} RewindBuffer;
+
+RewindBuffer *createRewindBuffer(int budget, int frameCapacity);
+
+void recordRewindFrame(RewindBuffer *, const uint8_t *frame, int size, uint64_t hash);
+
+int restoreRewindFrame(RewindBuffer *, uint32_t tick, uint8_t *frame);
+
+void truncateRewind(RewindBuffer *, uint32_t tick);
+
+bool hasRewindFrame(RewindBuffer *, uint32_t tick);
+
+uint64_t rewindFrameHash(RewindBuffer *, uint32_t tick);
+
+void freeRewindBuffer(RewindBuffer *);
+
+# endif
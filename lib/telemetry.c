@@ -0,0 +1,57 @@
+# include <stdlib.h>
+# include <string.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include "telemetry.h"
+
+
+Telemetry *openTelemetry(const char *path, uint32_t capacity) {
+    uint64_t size = sizeof(TelemetryHeader) + (uint64_t)capacity*sizeof(TelemetryRecord);
+
+    int file = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) return NULL;
+    if (ftruncate(file, size) != 0) {
+        close(file);
+        return NULL;
+    }
+
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (mapping == MAP_FAILED) {
+        close(file);
+        return NULL;
+    }
+
+    Telemetry *telemetry = (Telemetry *)malloc(sizeof(Telemetry));
+    telemetry->header = (TelemetryHeader *)mapping;
+    telemetry->records = (TelemetryRecord *)((uint8_t *)mapping + sizeof(TelemetryHeader));
+    telemetry->mappedSize = size;
+    telemetry->file = file;
+
+    TelemetryHeader *header = telemetry->header;
+    memcpy(header->magic, TELEMETRY_MAGIC, 4);
+    header->version = TELEMETRY_VERSION;
+    header->recordSize = sizeof(TelemetryRecord);
+    header->capacity = capacity;
+    atomic_store_explicit(&header->written, 0, memory_order_release);
+
+    return telemetry;
+}
+
+// The count is only bumped once the record is whole, so a crash in the
+// middle of a copy leaves the previous tick as the last one in the file
+void writeTelemetry(Telemetry *telemetry, TelemetryRecord *record) {
+    TelemetryHeader *header = telemetry->header;
+    uint64_t written = atomic_load_explicit(&header->written, memory_order_relaxed);
+
+    record->sequence = written;
+    telemetry->records[written % header->capacity] = *record;
+    atomic_store_explicit(&header->written, written + 1, memory_order_release);
+}
+
+void closeTelemetry(Telemetry *telemetry) {
+    msync(telemetry->header, telemetry->mappedSize, MS_SYNC);
+    munmap(telemetry->header, telemetry->mappedSize);
+    close(telemetry->file);
+    free(telemetry);
+}
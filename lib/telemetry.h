@@ -0,0 +1,87 @@
+# ifndef _TELEMETRY_H_
+# define _TELEMETRY_H_
+
+# include <stdint.h>
+# include <stdatomic.h>
+# include "hash.h"
+
+# define TELEMETRY_MAGIC "SITL"
+# define TELEMETRY_VERSION 3
+# define TELEMETRY_DEFAULT_CAPACITY (1 << 16)
+
+typedef enum TelemetryEvent {
+    EVENT_ALIEN_KILLED = 1 << 0,
+    EVENT_ENEMY_SHIP_KILLED = 1 << 1,
+    EVENT_PLAYER_KILLED = 1 << 2,
+    EVENT_POWERUP_TAKEN = 1 << 3,
+    EVENT_WAVE_CLEARED = 1 << 4,
+    EVENT_STATE_CHANGED = 1 << 5,
+    EVENT_REWOUND = 1 << 6,
+    EVENT_INTERCEPTED = 1 << 7,
+} TelemetryEvent;
+
+// One tick, fixed size so a record never straddles the end of the ring.
+// Phase times are in seconds. The lane hashes are truncated, they only
+// need to tell which subsystem a divergence started in. Render counts are
+// only filled in when drawing goes through the recording backend.
+typedef struct TelemetryRecord {
+    uint64_t sequence;
+    uint64_t stateHash;
+    uint32_t laneHashes[HASH_LANES];
+    float frameTime;
+    float collisionTime;
+    float shipTime;
+    float hordeTime;
+    float enemyShipTime;
+    float projectileTime;
+    float particleTime;
+    uint32_t collisionTests;
+    uint32_t particles;
+    uint32_t quads;
+    uint32_t coveredPixels;
+    uint16_t aliensAlive;
+    uint16_t playerBullets;
+    uint16_t enemyBullets;
+    uint16_t powerups;
+    uint16_t events;
+    uint16_t drawCalls;
+    uint16_t textureSwitches;
+    uint16_t glyphs;
+    uint8_t kills;
+    uint8_t shots;
+    uint8_t gameState;
+    uint8_t wave;
+    uint8_t reserved[24];
+} TelemetryRecord;
+
+_Static_assert(sizeof(TelemetryRecord) == 128, "telemetry records are two cache lines");
+
+// The first 64 bytes of the file, records follow. written counts every
+// record ever committed, the ring holds the last capacity of them.
+typedef struct TelemetryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+    _Atomic uint64_t written;
+    uint8_t reserved[40];
+} TelemetryHeader;
+
+_Static_assert(sizeof(TelemetryHeader) == 64, "records start on a cache line");
+
+// A shared file mapping: stores land in the page cache, so whatever was
+// committed survives the process crashing and no write needs a syscall
+typedef struct Telemetry {
+    TelemetryHeader *header;
+    TelemetryRecord *records;
+    uint64_t mappedSize;
+    int file;
+} Telemetry;
+
+Telemetry *openTelemetry(const char *path, uint32_t capacity);
+
+void writeTelemetry(Telemetry *, TelemetryRecord *);
+
+void closeTelemetry(Telemetry *);
+
+# endif
@@ -0,0 +1,256 @@
+# include <stdlib.h>
+# include <string.h>
+# include "timer.h"
+# include "hash.h"
+
+
+# define SLOT_MASK (TIMER_SLOTS - 1)
+# define NOT_PENDING 0xFFFF
+
+uint64_t hashTimer(const Timer *timer) {
+    return mixHash((uint64_t)timer->expires << 32 ^ (uint64_t)timer->event << 24 ^ (uint32_t)timer->payload);
+}
+
+TimerWheel *createTimerWheel() {
+    TimerWheel *wheel = (TimerWheel *)malloc(sizeof(TimerWheel));
+    resetTimerWheel(wheel);
+
+    return wheel;
+}
+
+// Every timer free and no slot holding any, generations are left alone
+void emptyTimerWheel(TimerWheel *wheel) {
+    for (int level = 0; level < TIMER_LEVELS; ++level) {
+        for (int slot = 0; slot < TIMER_SLOTS; ++slot) {
+            wheel->slots[level][slot] = -1;
+        }
+    }
+    for (int i = 0; i < TIMER_CAPACITY; ++i) {
+        wheel->timers[i].bucket = NOT_PENDING;
+    }
+    memset(wheel->freeSlots, 0xFF, sizeof(wheel->freeSlots));
+}
+
+void resetTimerWheel(TimerWheel *wheel) {
+    emptyTimerWheel(wheel);
+    for (int i = 0; i < TIMER_CAPACITY; ++i) {
+        wheel->timers[i].generation = 0;
+    }
+    wheel->now = 0;
+    wheel->hash = 0;
+}
+
+// The lowest level whose span reaches the expiry, and the slot the expiry
+// falls in there
+void linkTimer(TimerWheel *wheel, int index) {
+    Timer *timer = &wheel->timers[index];
+    uint32_t delta = timer->expires - wheel->now;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= 1u << (TIMER_SLOT_BITS*(level + 1))) ++level;
+    int slot = (timer->expires >> (TIMER_SLOT_BITS*level)) & SLOT_MASK;
+
+    int16_t *head = &wheel->slots[level][slot];
+    timer->bucket = level*TIMER_SLOTS + slot;
+    timer->prev = -1;
+    timer->next = *head;
+    if (*head >= 0) wheel->timers[*head].prev = index;
+    *head = index;
+}
+
+void unlinkTimer(TimerWheel *wheel, int index) {
+    Timer *timer = &wheel->timers[index];
+    if (timer->prev >= 0) {
+        wheel->timers[timer->prev].next = timer->next;
+    } else {
+        wheel->slots[timer->bucket/TIMER_SLOTS][timer->bucket%TIMER_SLOTS] = timer->next;
+    }
+    if (timer->next >= 0) wheel->timers[timer->next].prev = timer->prev;
+}
+
+void releaseTimer(TimerWheel *wheel, int index) {
+    Timer *timer = &wheel->timers[index];
+    wheel->hash ^= hashTimer(timer);
+    timer->bucket = NOT_PENDING;
+    timer->generation++;
+    wheel->freeSlots[index/64] |= 1ull << (index%64);
+}
+
+int takeFreeTimer(TimerWheel *wheel) {
+    for (int word = 0; word < TIMER_FREE_WORDS; ++word) {
+        if (wheel->freeSlots[word] == 0) continue;
+        int index = word*64 + __builtin_ctzll(wheel->freeSlots[word]);
+        wheel->freeSlots[word] &= wheel->freeSlots[word] - 1;
+        return index;
+    }
+    return -1;
+}
+
+// Low bits are the slot plus one, so no handle is ever 0, high bits the
+// generation, so a handle goes stale once its slot is reused
+TimerHandle scheduleTimer(TimerWheel *wheel, uint32_t delay, int event, int payload) {
+    int index = takeFreeTimer(wheel);
+    if (index < 0) return NO_TIMER;
+
+    // The slot for the current tick has already been fired
+    if (delay < 1) delay = 1;
+    // The top level can't tell apart expiries a whole span apart
+    const uint32_t horizon = (1u << (TIMER_SLOT_BITS*TIMER_LEVELS)) - 1;
+    if (delay > horizon) delay = horizon;
+
+    Timer *timer = &wheel->timers[index];
+    timer->expires = wheel->now + delay;
+    timer->event = event;
+    timer->payload = payload;
+    linkTimer(wheel, index);
+    wheel->hash ^= hashTimer(timer);
+
+    return (TimerHandle)timer->generation << 16 | (index + 1);
+}
+
+int pendingIndex(const TimerWheel *wheel, TimerHandle handle) {
+    int index = (int)(handle & 0xFFFF) - 1;
+    if (index < 0 || index >= TIMER_CAPACITY) return -1;
+
+    const Timer *timer = &wheel->timers[index];
+    if (timer->bucket == NOT_PENDING || timer->generation != handle >> 16) return -1;
+    return index;
+}
+
+void cancelTimer(TimerWheel *wheel, TimerHandle handle) {
+    int index = pendingIndex(wheel, handle);
+    if (index < 0) return;
+
+    unlinkTimer(wheel, index);
+    releaseTimer(wheel, index);
+}
+
+bool timerPending(const TimerWheel *wheel, TimerHandle handle) {
+    return pendingIndex(wheel, handle) >= 0;
+}
+
+uint32_t timerRemaining(const TimerWheel *wheel, TimerHandle handle) {
+    int index = pendingIndex(wheel, handle);
+    return index < 0 ? 0 : wheel->timers[index].expires - wheel->now;
+}
+
+// Moves every timer in a slot of an upper level down to where it belongs now
+void cascadeTimers(TimerWheel *wheel, int level, int slot) {
+    int index = wheel->slots[level][slot];
+    wheel->slots[level][slot] = -1;
+
+    while (index >= 0) {
+        int next = wheel->timers[index].next;
+        linkTimer(wheel, index);
+        index = next;
+    }
+}
+
+void advanceTimerWheel(TimerWheel *wheel, uint32_t tick, TimerCallback callback, void *context) {
+    while ((int32_t)(tick - wheel->now) > 0) {
+        wheel->now++;
+
+        // An upper level slot comes due each time every level below it wraps
+        for (int level = 1; level < TIMER_LEVELS; ++level) {
+            int shift = TIMER_SLOT_BITS*level;
+            if (wheel->now & ((1u << shift) - 1)) break;
+            cascadeTimers(wheel, level, (wheel->now >> shift) & SLOT_MASK);
+        }
+
+        // Popped one at a time from the head, a callback can schedule into
+        // or cancel out of this very slot
+        int16_t *head = &wheel->slots[0][wheel->now & SLOT_MASK];
+        while (*head >= 0) {
+            int index = *head;
+            Timer *timer = &wheel->timers[index];
+            int event = timer->event;
+            int payload = timer->payload;
+            unlinkTimer(wheel, index);
+            releaseTimer(wheel, index);
+            callback(context, event, payload);
+        }
+    }
+}
+
+uint8_t *packBytes(uint8_t *cursor, const void *data, int size) {
+    memcpy(cursor, data, size);
+    return cursor + size;
+}
+
+const uint8_t *unpackBytes(const uint8_t *cursor, void *data, int size) {
+    memcpy(data, cursor, size);
+    return cursor + size;
+}
+
+int packTimerWheel(const TimerWheel *wheel, uint8_t *buffer) {
+    uint8_t *cursor = buffer;
+    uint16_t pending = 0;
+    for (int i = 0; i < TIMER_CAPACITY; ++i) pending += wheel->timers[i].bucket != NOT_PENDING;
+
+    cursor = packBytes(cursor, &wheel->now, sizeof(uint32_t));
+    cursor = packBytes(cursor, &wheel->hash, sizeof(uint64_t));
+    cursor = packBytes(cursor, &pending, sizeof(uint16_t));
+    // Stale handles have to stay stale
+    for (int i = 0; i < TIMER_CAPACITY; ++i) {
+        cursor = packBytes(cursor, &wheel->timers[i].generation, sizeof(uint16_t));
+    }
+
+    for (int bucket = 0; bucket < TIMER_LEVELS*TIMER_SLOTS; ++bucket) {
+        int16_t index = wheel->slots[bucket/TIMER_SLOTS][bucket%TIMER_SLOTS];
+        for (; index >= 0; index = wheel->timers[index].next) {
+            const Timer *timer = &wheel->timers[index];
+            cursor = packBytes(cursor, &index, sizeof(int16_t));
+            cursor = packBytes(cursor, &timer->bucket, sizeof(uint16_t));
+            cursor = packBytes(cursor, &timer->expires, sizeof(uint32_t));
+            cursor = packBytes(cursor, &timer->payload, sizeof(int32_t));
+            cursor = packBytes(cursor, &timer->event, sizeof(int16_t));
+        }
+    }
+
+    return cursor - buffer;
+}
+
+// Timers go back in the bucket they were packed from rather than the one
+// the clock would pick now, a timer waiting on a cascade must still come
+// down ahead of the ones already in its slot
+int unpackTimerWheel(TimerWheel *wheel, const uint8_t *buffer) {
+    const uint8_t *cursor = buffer;
+    uint16_t pending;
+    int16_t tails[TIMER_LEVELS*TIMER_SLOTS];
+
+    emptyTimerWheel(wheel);
+    memset(tails, 0xFF, sizeof(tails));
+    cursor = unpackBytes(cursor, &wheel->now, sizeof(uint32_t));
+    cursor = unpackBytes(cursor, &wheel->hash, sizeof(uint64_t));
+    cursor = unpackBytes(cursor, &pending, sizeof(uint16_t));
+    for (int i = 0; i < TIMER_CAPACITY; ++i) {
+        cursor = unpackBytes(cursor, &wheel->timers[i].generation, sizeof(uint16_t));
+    }
+
+    for (int i = 0; i < pending; ++i) {
+        int16_t index;
+        cursor = unpackBytes(cursor, &index, sizeof(int16_t));
+        Timer *timer = &wheel->timers[index];
+        cursor = unpackBytes(cursor, &timer->bucket, sizeof(uint16_t));
+        cursor = unpackBytes(cursor, &timer->expires, sizeof(uint32_t));
+        cursor = unpackBytes(cursor, &timer->payload, sizeof(int32_t));
+        cursor = unpackBytes(cursor, &timer->event, sizeof(int16_t));
+
+        // Appended, so every slot keeps its order
+        int16_t *tail = &tails[timer->bucket];
+        timer->prev = *tail;
+        timer->next = -1;
+        if (*tail >= 0) {
+            wheel->timers[*tail].next = index;
+        } else {
+            wheel->slots[timer->bucket/TIMER_SLOTS][timer->bucket%TIMER_SLOTS] = index;
+        }
+        *tail = index;
+        wheel->freeSlots[index/64] &= ~(1ull << (index%64));
+    }
+
+    return cursor - buffer;
+}
+
+void freeTimerWheel(TimerWheel *wheel) {
+    free(wheel);
+}
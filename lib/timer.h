@@ -0,0 +1,82 @@
+# ifndef _TIMER_H_
+# define _TIMER_H_
+
+# include <stdint.h>
+# include <stdbool.h>
+
+# define TIMER_LEVELS 4
+# define TIMER_SLOT_BITS 6
+# define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+# define TIMER_CAPACITY 256
+# define TIMER_FREE_WORDS (TIMER_CAPACITY/64)
+// A packed wheel is the clock, the hash, the pending count and every
+// generation, then 14 bytes per pending timer
+# define TIMER_PACKED_HEADER (4 + 8 + 2 + 2*TIMER_CAPACITY)
+# define TIMER_PACKED_TIMER 14
+# define TIMER_PACKED_CAPACITY (TIMER_PACKED_HEADER + TIMER_CAPACITY*TIMER_PACKED_TIMER)
+
+// 0 is never handed out, so it can stand for no timer
+typedef uint32_t TimerHandle;
+# define NO_TIMER 0
+
+typedef void (*TimerCallback)(void *context, int event, int payload);
+
+typedef struct Timer {
+    uint32_t expires;
+    int32_t payload;
+    int16_t next;
+    int16_t prev;
+    int16_t event;
+    // Level times slots plus slot, so the head can be found to unlink
+    uint16_t bucket;
+    uint16_t generation;
+} Timer;
+
+// Hierarchical wheel over integer ticks. Level 0 holds the next 64 ticks
+// one per slot, every level above covers 64 times the span of the one
+// below and is spilled down a slot at a time as the clock reaches it.
+// Scheduling and cancelling are O(1), so is each tick, whatever the number
+// of pending timers. Links are indices into one flat struct. Free timers are
+// handed out lowest index first, so the pending ones, in the order they sit
+// in their slots, and the generations pin the whole wheel down.
+typedef struct TimerWheel {
+    Timer timers[TIMER_CAPACITY];
+    int16_t slots[TIMER_LEVELS][TIMER_SLOTS];
+    // One bit per timer, set while it is free
+    uint64_t freeSlots[TIMER_FREE_WORDS];
+    uint32_t now;
+    // XOR over every pending timer, patched as they come and go
+    uint64_t hash;
+} TimerWheel;
+
+TimerWheel *createTimerWheel();
+
+void resetTimerWheel(TimerWheel *);
+
+// Fires delay ticks from now, at least one. Returns NO_TIMER when full.
+TimerHandle scheduleTimer(TimerWheel *, uint32_t delay, int event, int payload);
+
+// Handles that already fired or were cancelled are ignored
+void cancelTimer(TimerWheel *, TimerHandle);
+
+bool timerPending(const TimerWheel *, TimerHandle);
+
+// Ticks left, 0 for a handle that is not pending
+uint32_t timerRemaining(const TimerWheel *, TimerHandle);
+
+// Runs the clock up to tick, firing every timer due on the way in the order
+// they come due. Callbacks may schedule and cancel.
+void advanceTimerWheel(TimerWheel *, uint32_t tick, TimerCallback, void *context);
+
+// Writes only what pins the wheel down, for rewind frames. The fixed size
+// header comes first and the pending timers after it, bucket by bucket and
+// each bucket in list order. Returns the bytes written, at most
+// TIMER_PACKED_CAPACITY.
+int packTimerWheel(const TimerWheel *, uint8_t *buffer);
+
+// Gives back the wheel packTimerWheel saw, returns the bytes read
+int unpackTimerWheel(TimerWheel *, const uint8_t *buffer);
+
+void freeTimerWheel(TimerWheel *);
+
+# endif
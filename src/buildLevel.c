@@ -0,0 +1,180 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <strings.h>
+# include <stdbool.h>
+# include "../lib/entity.h"
+
+
+// Turns a text level into the binary file loadLevel reads. The format is
+// described at the top of assets/levels/waves.txt.
+
+# define KIND_NAME(kind, Name, ...) #Name,
+static const char *kindNames[] = {ALIEN_KINDS(KIND_NAME)};
+# undef KIND_NAME
+
+typedef struct LevelWriter {
+    uint8_t data[6 + LEVEL_MAX_WAVES*(3 + 2*LEVEL_MAX_BANDS + 24)];
+    int size;
+} LevelWriter;
+
+void printUsage(const char *program) {
+    printf("Usage: %s LEVEL_TEXT OUTPUT_LVL\n", program);
+}
+
+void writeLevelBytes(LevelWriter *writer, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        writer->data[writer->size++] = (uint8_t)(value >> (8*i));
+    }
+}
+
+void writeLevelFloat(LevelWriter *writer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    writeLevelBytes(writer, bits, 4);
+}
+
+void writeWave(LevelWriter *writer, const LevelWave *wave) {
+    writeLevelBytes(writer, wave->rows, 1);
+    writeLevelBytes(writer, wave->columns, 1);
+    writeLevelBytes(writer, wave->bandCount, 1);
+    for (int i = 0; i < wave->bandCount; ++i) {
+        writeLevelBytes(writer, wave->bands[i].rows, 1);
+        writeLevelBytes(writer, wave->bands[i].kind, 1);
+    }
+    writeLevelFloat(writer, wave->hordeSpeed);
+    writeLevelFloat(writer, wave->hordeSpeedIncrease);
+    writeLevelFloat(writer, wave->hordeStepY);
+    writeLevelBytes(writer, wave->fireChance, 4);
+    writeLevelFloat(writer, wave->enemyShipSleepTime);
+    writeLevelFloat(writer, wave->enemyShipDelayToFire);
+}
+
+int findKind(const char *name) {
+    for (int kind = 0; kind < ALIEN_KIND_COUNT; ++kind) {
+        if (strcasecmp(name, kindNames[kind]) == 0) return kind;
+    }
+    return -1;
+}
+
+// Each band is KIND:ROWS, top to bottom
+bool parseBands(LevelWave *wave, char *bands) {
+    wave->bandCount = 0;
+    wave->rows = 0;
+    for (char *band = strtok(bands, " \t"); band != NULL; band = strtok(NULL, " \t")) {
+        char *separator = strchr(band, ':');
+        if (separator == NULL || wave->bandCount == LEVEL_MAX_BANDS) return false;
+        *separator = '\0';
+
+        int kind = findKind(band);
+        int rows = atoi(separator + 1);
+        if (kind < 0 || rows < 1) return false;
+        wave->bands[wave->bandCount++] = (LevelBand){.rows=rows, .kind=kind};
+        wave->rows += rows;
+    }
+    return wave->bandCount > 0;
+}
+
+bool parseSetting(LevelWave *wave, const char *key, char *value) {
+    if (strcmp(key, "bands") == 0) return parseBands(wave, value);
+    if (strcmp(key, "columns") == 0) wave->columns = atoi(value);
+    else if (strcmp(key, "hordeSpeed") == 0) wave->hordeSpeed = strtof(value, NULL);
+    else if (strcmp(key, "hordeSpeedIncrease") == 0) wave->hordeSpeedIncrease = strtof(value, NULL);
+    else if (strcmp(key, "hordeStepY") == 0) wave->hordeStepY = strtof(value, NULL);
+    else if (strcmp(key, "fireChance") == 0) wave->fireChance = atoi(value);
+    else if (strcmp(key, "enemyShipSleepTime") == 0) wave->enemyShipSleepTime = strtof(value, NULL);
+    else if (strcmp(key, "enemyShipDelayToFire") == 0) wave->enemyShipDelayToFire = strtof(value, NULL);
+    else return false;
+    return true;
+}
+
+// The same limits loadLevel checks, caught here with a line number instead
+// of the game quietly falling back to the built-in wave
+const char *checkWave(const LevelWave *wave) {
+    int lastKind = 0;
+    for (int i = 0; i < wave->bandCount; ++i) {
+        if (wave->bands[i].kind < lastKind) return "bands go back to an earlier kind";
+        lastKind = wave->bands[i].kind;
+    }
+    if (wave->bandCount == 0) return "no bands";
+    if (wave->columns < 1) return "no columns";
+    if (wave->rows*wave->columns > HORDE_SIZE) return "more aliens than the horde holds";
+    if (wave->hordeSpeed <= 0.0f) return "horde speed is not positive";
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    FILE *input = fopen(argv[1], "r");
+    if (input == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    static Level level;
+    LevelWave *wave = NULL;
+    int waveLine = 0;
+    char line[256];
+    for (int number = 1; fgets(line, sizeof(line), input) != NULL; ++number) {
+        char *key = strtok(line, " \t\r\n");
+        if (key == NULL || key[0] == '#') continue;
+        char *value = strtok(NULL, "\r\n");
+
+        const char *error = NULL;
+        int errorLine = number;
+        if (strcmp(key, "wave") == 0) {
+            // A wave is only complete once the next one starts
+            if (wave != NULL) {
+                error = checkWave(wave);
+                errorLine = waveLine;
+            }
+            if (error == NULL && level.waveCount == LEVEL_MAX_WAVES) {
+                error = "too many waves";
+                errorLine = number;
+            }
+            if (error == NULL) {
+                wave = &level.waves[level.waveCount++];
+                waveLine = number;
+            }
+        } else if (wave == NULL) {
+            error = "setting outside of a wave";
+        } else if (value == NULL || !parseSetting(wave, key, value)) {
+            error = "unknown or malformed setting";
+        }
+
+        if (error != NULL) {
+            fprintf(stderr, "%s:%d: %s\n", argv[1], errorLine, error);
+            fclose(input);
+            return 1;
+        }
+    }
+    fclose(input);
+
+    const char *error = wave == NULL ? "no waves" : checkWave(wave);
+    if (error != NULL) {
+        fprintf(stderr, "%s:%d: %s\n", argv[1], waveLine, error);
+        return 1;
+    }
+
+    LevelWriter writer = {.size=0};
+    memcpy(writer.data, LEVEL_MAGIC, 4);
+    writer.size = 4;
+    writeLevelBytes(&writer, LEVEL_VERSION, 1);
+    writeLevelBytes(&writer, level.waveCount, 1);
+    for (int i = 0; i < level.waveCount; ++i) writeWave(&writer, &level.waves[i]);
+
+    FILE *output = fopen(argv[2], "wb");
+    if (output == NULL || fwrite(writer.data, 1, writer.size, output) != (size_t)writer.size) {
+        fprintf(stderr, "Could not write %s\n", argv[2]);
+        if (output != NULL) fclose(output);
+        return 1;
+    }
+    fclose(output);
+    printf("Wrote %d waves to %s\n", level.waveCount, argv[2]);
+
+    return 0;
+}
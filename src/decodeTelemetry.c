@@ -0,0 +1,102 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include "../lib/telemetry.h"
+
+
+// Converts a telemetry ring written by the game into CSV, oldest tick first
+
+void printUsage(const char *program) {
+    printf("Usage: %s TELEMETRY_FILE [OUTPUT_CSV]\n", program);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    FILE *input = fopen(argv[1], "rb");
+    if (input == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    TelemetryHeader header;
+    if (fread(&header, sizeof(header), 1, input) != 1 ||
+        memcmp(header.magic, TELEMETRY_MAGIC, 4) != 0 ||
+        header.version != TELEMETRY_VERSION ||
+        header.recordSize != sizeof(TelemetryRecord) ||
+        header.capacity == 0) {
+        fprintf(stderr, "%s is not a telemetry file this decoder understands\n", argv[1]);
+        fclose(input);
+        return 1;
+    }
+
+    FILE *output = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (output == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        fclose(input);
+        return 1;
+    }
+
+    uint64_t written = atomic_load(&header.written);
+    uint64_t first = written > header.capacity ? written - header.capacity : 0;
+
+    fprintf(
+        output,
+        "sequence,frame_ms,collision_ms,ship_ms,horde_ms,enemy_ship_ms,projectile_ms,particle_ms,"
+        "collision_tests,particles,aliens_alive,player_bullets,enemy_bullets,powerups,"
+        "events,kills,shots,game_state,wave,state_hash,hot_hash,formation_hash,projectile_hash,bunker_hash,random_hash,"
+        "draw_calls,texture_switches,quads,glyphs,covered_pixels\n"
+    );
+
+    for (uint64_t sequence = first; sequence < written; ++sequence) {
+        TelemetryRecord record;
+        long offset = sizeof(TelemetryHeader) + (sequence % header.capacity)*sizeof(TelemetryRecord);
+        if (fseek(input, offset, SEEK_SET) != 0 || fread(&record, sizeof(record), 1, input) != 1) break;
+        // A slot the writer was overwriting when it stopped
+        if (record.sequence != sequence) continue;
+
+        fprintf(
+            output,
+            "%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%u,%u,%u,0x%02x,%u,%u,%u,%u,"
+            "%016llx,%08x,%08x,%08x,%08x,%08x,%u,%u,%u,%u,%u\n",
+            (unsigned long long)record.sequence,
+            record.frameTime*1000.0f,
+            record.collisionTime*1000.0f,
+            record.shipTime*1000.0f,
+            record.hordeTime*1000.0f,
+            record.enemyShipTime*1000.0f,
+            record.projectileTime*1000.0f,
+            record.particleTime*1000.0f,
+            record.collisionTests,
+            record.particles,
+            record.aliensAlive,
+            record.playerBullets,
+            record.enemyBullets,
+            record.powerups,
+            record.events,
+            record.kills,
+            record.shots,
+            record.gameState,
+            record.wave,
+            (unsigned long long)record.stateHash,
+            record.laneHashes[HASH_HOT],
+            record.laneHashes[HASH_FORMATION],
+            record.laneHashes[HASH_PROJECTILES],
+            record.laneHashes[HASH_BUNKERS],
+            record.laneHashes[HASH_RANDOM],
+            record.drawCalls,
+            record.textureSwitches,
+            record.quads,
+            record.glyphs,
+            record.coveredPixels
+        );
+    }
+
+    if (output != stdout) fclose(output);
+    fclose(input);
+
+    return 0;
+}
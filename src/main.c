@@ -1,9 +1,90 @@
 # include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
 # include "../lib/game.h"
 
 
-int main() {
-    mainLoop();
+void printUsage(const char *program) {
+    printf("Usage: %s [--host PORT | --spectate ADDRESS PORT] [--loss RATE] [--latency MS] [--intercept] [--telemetry FILE] [--seed N] [--speed SCALE] [--perf] [--metrics [NAME]] [--render-stats | --headless] [--render-budget DRAWS,SWITCHES,QUADS,OVERDRAW] [--record-input FILE] [--replay-input FILE]\n", program);
+}
+
+int main(int argc, char **argv) {
+    Options options = {
+        .netRole=NET_OFF,
+        .netAddress="127.0.0.1",
+        .netPort=NET_DEFAULT_PORT,
+        .netLossRate=0.0f,
+        .netLatency=0.0f,
+        .bulletInterception=false,
+        .telemetryPath=NULL,
+        .seed=0,
+        .timeScale=1.0f,
+        .perfCounters=false,
+        .metricsName=NULL,
+        .renderMode=RENDER_DIRECT,
+        .inputRecordPath=NULL,
+        .inputReplayPath=NULL,
+        .renderBudget={.drawCalls=0},
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            options.netRole = NET_HOST;
+            options.netPort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--spectate") == 0 && i + 2 < argc) {
+            options.netRole = NET_SPECTATOR;
+            options.netAddress = argv[++i];
+            options.netPort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            options.netLossRate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            options.netLatency = atof(argv[++i])/1000.0f;
+        } else if (strcmp(argv[i], "--intercept") == 0) {
+            options.bulletInterception = true;
+        } else if (strcmp(argv[i], "--metrics") == 0) {
+            // Segment names start with a slash, anything else is the next flag
+            options.metricsName = i + 1 < argc && argv[i + 1][0] == '/' ? argv[++i] : METRICS_DEFAULT_NAME;
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            options.perfCounters = true;
+        } else if (strcmp(argv[i], "--render-stats") == 0) {
+            options.renderMode = RENDER_COUNTED;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            options.renderMode = RENDER_HEADLESS;
+        } else if (strcmp(argv[i], "--render-budget") == 0 && i + 1 < argc) {
+            // Per frame limits, 0 leaves one unchecked
+            RenderBudget *budget = &options.renderBudget;
+            unsigned long long drawCalls, textureSwitches, quads;
+            if (sscanf(argv[++i], "%llu,%llu,%llu,%f", &drawCalls, &textureSwitches, &quads, &budget->overdraw) != 4) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            budget->drawCalls = drawCalls;
+            budget->textureSwitches = textureSwitches;
+            budget->quads = quads;
+            // A budget is only checked on a counted run
+            if (options.renderMode == RENDER_DIRECT) options.renderMode = RENDER_COUNTED;
+        } else if (strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+            options.inputRecordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc) {
+            options.inputReplayPath = argv[++i];
+        } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            options.telemetryPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            options.timeScale = strtof(argv[++i], NULL);
+            if (options.timeScale <= 0.0f) options.timeScale = 1.0f;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Nothing else could ever move a headless game out of the menu
+    if (options.renderMode == RENDER_HEADLESS && options.inputReplayPath == NULL) {
+        fprintf(stderr, "--headless needs --replay-input FILE\n");
+        return 1;
+    }
 
-    return 0;
+    return mainLoop(&options);
 }
@@ -0,0 +1,88 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <time.h>
+# include "../lib/metrics.h"
+
+
+// Follows the live metrics of a running game, one line per interval
+
+void printUsage(const char *program) {
+    printf("Usage: %s [--name SEGMENT] [--interval MS] [--once]\n", program);
+}
+
+void printMetrics(const LiveMetrics *metrics) {
+    printf(
+        "frame %llu  fps %.0f  frame %.2fms  tick %.2fms  x%.1f  %s wave %u  "
+        "aliens %u  bullets %u/%u  powerups %u  particles %u",
+        (unsigned long long)metrics->frame,
+        metrics->fps,
+        metrics->frameTime*1000.0f,
+        metrics->tickTime*1000.0f,
+        metrics->timeScale,
+        metricsStateName(metrics->gameState),
+        metrics->wave + 1,
+        metrics->aliensAlive,
+        metrics->playerBullets,
+        metrics->enemyBullets,
+        metrics->powerups,
+        metrics->particles
+    );
+    if (metrics->fastShotActive) printf("  fast shot %.1fs", metrics->fastShotRemaining);
+    if (metrics->fastMoveActive) printf("  fast move %.1fs", metrics->fastMoveRemaining);
+    if (metrics->enemyShipActive) printf("  enemy ship");
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    const char *name = METRICS_DEFAULT_NAME;
+    long interval = 1000;
+    int once = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = atol(argv[++i]);
+            if (interval < 1) interval = 1;
+        } else if (strcmp(argv[i], "--once") == 0) {
+            once = 1;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    MetricsSegment *segment = attachMetrics(name);
+    if (segment == NULL) {
+        fprintf(stderr, "No running game publishes metrics as %s\n", name);
+        return 1;
+    }
+    printf("Attached to %s, published by pid %d\n", name, segment->pid);
+
+    const struct timespec pause = {.tv_sec=interval/1000, .tv_nsec=(interval%1000)*1000000};
+    uint64_t lastFrame = UINT64_MAX;
+    LiveMetrics metrics;
+    for (;;) {
+        bool fresh = false;
+        if (readMetrics(segment, &metrics, 64)) {
+            // The last frame a game publishes is in the close state, the
+            // mapping outlives the segment so that is how its end shows
+            if (metrics.frame == lastFrame && metrics.gameState == METRICS_CLOSE) break;
+            fresh = metrics.frame != lastFrame;
+            if (fresh) printMetrics(&metrics);
+            lastFrame = metrics.frame;
+        }
+        if (!fresh && !metricsPublisherAlive(segment)) {
+            printf("Publisher pid %d is gone\n", segment->pid);
+            break;
+        }
+        if (once) break;
+        nanosleep(&pause, NULL);
+    }
+
+    detachMetrics(segment);
+
+    return 0;
+}